@@ -0,0 +1,138 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fluentbenchbridge.h"
+
+#include <KDecoration2/DecoratedClient>
+#include <KDecoration2/Decoration>
+#include <KDecoration2/DecorationSettings>
+
+#include <QGuiApplication>
+
+namespace Fluent
+{
+
+    using KDecoration2::ColorGroup;
+    using KDecoration2::ColorRole;
+    using KDecoration2::DecorationButtonType;
+
+    //__________________________________________________________________
+    BenchClient::BenchClient( KDecoration2::DecoratedClient *client, KDecoration2::Decoration *decoration ):
+        KDecoration2::DecoratedClientPrivate( client, decoration ),
+        m_caption( QStringLiteral( "Fluent decoration benchmark" ) ),
+        m_size( 800, 600 ),
+        m_palette( QGuiApplication::palette() )
+    {}
+
+    //__________________________________________________________________
+    void BenchClient::setActive( bool value )
+    {
+        if( m_active == value ) return;
+        m_active = value;
+        emit client()->activeChanged( value );
+    }
+
+    //__________________________________________________________________
+    void BenchClient::setCaption( const QString &value )
+    {
+        if( m_caption == value ) return;
+        m_caption = value;
+        emit client()->captionChanged( value );
+    }
+
+    //__________________________________________________________________
+    void BenchClient::setSize( const QSize &value )
+    {
+        if( m_size == value ) return;
+
+        const QSize old( m_size );
+        m_size = value;
+        if( old.width() != value.width() ) emit client()->widthChanged( value.width() );
+        if( old.height() != value.height() ) emit client()->heightChanged( value.height() );
+    }
+
+    //__________________________________________________________________
+    QColor BenchClient::color( ColorGroup group, ColorRole role ) const
+    {
+        // the colors kwin takes from the default color scheme
+        const bool active( group == ColorGroup::Active );
+        switch( role )
+        {
+            case ColorRole::TitleBar:
+            return m_palette.color( active ? QPalette::Highlight : QPalette::Window );
+
+            case ColorRole::Foreground:
+            return m_palette.color( active ? QPalette::HighlightedText : QPalette::WindowText );
+
+            case ColorRole::Frame:
+            default:
+            return m_palette.color( QPalette::Window );
+        }
+    }
+
+    //__________________________________________________________________
+    BenchSettings::BenchSettings( KDecoration2::DecorationSettings *parent ):
+        KDecoration2::DecorationSettingsPrivate( parent )
+    {}
+
+    //__________________________________________________________________
+    QVector<DecorationButtonType> BenchSettings::decorationButtonsLeft() const
+    { return { DecorationButtonType::Menu, DecorationButtonType::OnAllDesktops }; }
+
+    //__________________________________________________________________
+    QVector<DecorationButtonType> BenchSettings::decorationButtonsRight() const
+    {
+        return {
+            DecorationButtonType::ContextHelp,
+            DecorationButtonType::Minimize,
+            DecorationButtonType::Maximize,
+            DecorationButtonType::Close };
+    }
+
+    //__________________________________________________________________
+    BenchBridge::BenchBridge( QObject *parent ):
+        KDecoration2::DecorationBridge( parent )
+    {}
+
+    //__________________________________________________________________
+    std::unique_ptr<KDecoration2::DecoratedClientPrivate> BenchBridge::createClient( KDecoration2::DecoratedClient *client, KDecoration2::Decoration *decoration )
+    {
+        std::unique_ptr<BenchClient> benchClient( new BenchClient( client, decoration ) );
+        m_clients.insert( decoration, benchClient.get() );
+        connect( decoration, &QObject::destroyed, this, [this, decoration]()
+        {
+            m_clients.remove( decoration );
+            m_damage.remove( decoration );
+        } );
+
+        return std::move( benchClient );
+    }
+
+    //__________________________________________________________________
+    void BenchBridge::update( KDecoration2::Decoration *decoration, const QRect &geometry )
+    { m_damage[decoration] += geometry; }
+
+    //__________________________________________________________________
+    std::unique_ptr<KDecoration2::DecorationSettingsPrivate> BenchBridge::settings( KDecoration2::DecorationSettings *parent )
+    { return std::unique_ptr<KDecoration2::DecorationSettingsPrivate>( new BenchSettings( parent ) ); }
+
+    //__________________________________________________________________
+    QRegion BenchBridge::takeDamage( KDecoration2::Decoration *decoration )
+    { return m_damage.take( decoration ); }
+
+}
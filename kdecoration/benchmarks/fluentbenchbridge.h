@@ -0,0 +1,152 @@
+#ifndef FLUENT_BENCHBRIDGE_H
+#define FLUENT_BENCHBRIDGE_H
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <KDecoration2/Private/DecoratedClientPrivate>
+#include <KDecoration2/Private/DecorationBridge>
+#include <KDecoration2/Private/DecorationSettingsPrivate>
+
+#include <QHash>
+#include <QRegion>
+
+#include <memory>
+
+namespace Fluent
+{
+
+    //* stand-in for a kwin window, its state is set by the benchmark scripts
+    class BenchClient: public KDecoration2::DecoratedClientPrivate
+    {
+
+        public:
+
+        //* constructor
+        BenchClient( KDecoration2::DecoratedClient*, KDecoration2::Decoration* );
+
+        //*@name state changes, they emit the signals kwin would emit
+        //@{
+        void setActive( bool );
+        void setCaption( const QString& );
+        void setSize( const QSize& );
+        //@}
+
+        //*@name window state
+        //@{
+        bool isActive() const override { return m_active; }
+        QString caption() const override { return m_caption; }
+        int desktop() const override { return 1; }
+        bool isOnAllDesktops() const override { return false; }
+        bool isShaded() const override { return false; }
+        QIcon icon() const override { return QIcon(); }
+        bool isMaximized() const override { return false; }
+        bool isMaximizedHorizontally() const override { return false; }
+        bool isMaximizedVertically() const override { return false; }
+        bool isKeepAbove() const override { return false; }
+        bool isKeepBelow() const override { return false; }
+        bool isCloseable() const override { return true; }
+        bool isMaximizeable() const override { return true; }
+        bool isMinimizeable() const override { return true; }
+        bool providesContextHelp() const override { return false; }
+        bool isModal() const override { return false; }
+        bool isShadeable() const override { return true; }
+        bool isMoveable() const override { return true; }
+        bool isResizeable() const override { return true; }
+        WId windowId() const override { return 0; }
+        WId decorationId() const override { return 0; }
+        int width() const override { return m_size.width(); }
+        int height() const override { return m_size.height(); }
+        QSize size() const { return m_size; }
+        QPalette palette() const override { return m_palette; }
+        QColor color( KDecoration2::ColorGroup, KDecoration2::ColorRole ) const override;
+        Qt::Edges adjacentScreenEdges() const override { return Qt::Edges(); }
+        //@}
+
+        //*@name requests from the buttons, ignored
+        //@{
+        void requestClose() override {}
+        void requestToggleMaximization( Qt::MouseButtons ) override {}
+        void requestMinimize() override {}
+        void requestContextHelp() override {}
+        void requestToggleOnAllDesktops() override {}
+        void requestToggleShade() override {}
+        void requestToggleKeepAbove() override {}
+        void requestToggleKeepBelow() override {}
+        void requestShowWindowMenu() override {}
+        //@}
+
+        private:
+
+        bool m_active = false;
+        QString m_caption;
+        QSize m_size;
+        QPalette m_palette;
+
+    };
+
+    //* stand-in for the kwin decoration settings
+    class BenchSettings: public KDecoration2::DecorationSettingsPrivate
+    {
+
+        public:
+
+        //* constructor
+        explicit BenchSettings( KDecoration2::DecorationSettings* );
+
+        bool isAlphaChannelSupported() const override { return true; }
+        bool isOnAllDesktopsAvailable() const override { return true; }
+        bool isCloseOnDoubleClickOnMenu() const override { return false; }
+        QVector<KDecoration2::DecorationButtonType> decorationButtonsLeft() const override;
+        QVector<KDecoration2::DecorationButtonType> decorationButtonsRight() const override;
+        KDecoration2::BorderSize borderSize() const override { return KDecoration2::BorderSize::Normal; }
+
+    };
+
+    //* stand-in for kwin, creates the clients and settings and collects the damage of every decoration
+    class BenchBridge: public KDecoration2::DecorationBridge
+    {
+
+        Q_OBJECT
+
+        public:
+
+        //* constructor
+        explicit BenchBridge( QObject *parent = nullptr );
+
+        std::unique_ptr<KDecoration2::DecoratedClientPrivate> createClient( KDecoration2::DecoratedClient*, KDecoration2::Decoration* ) override;
+        void update( KDecoration2::Decoration*, const QRect& ) override;
+        std::unique_ptr<KDecoration2::DecorationSettingsPrivate> settings( KDecoration2::DecorationSettings* ) override;
+
+        //* client of given decoration
+        BenchClient *client( KDecoration2::Decoration *decoration ) const
+        { return m_clients.value( decoration ); }
+
+        //* damage collected since the last call, for given decoration
+        QRegion takeDamage( KDecoration2::Decoration* );
+
+        private:
+
+        QHash<KDecoration2::Decoration*, BenchClient*> m_clients;
+        QHash<KDecoration2::Decoration*, QRegion> m_damage;
+
+    };
+
+}
+
+#endif
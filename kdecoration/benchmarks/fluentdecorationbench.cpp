@@ -0,0 +1,301 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Benchmark of the window decoration, without kwin.
+ *
+ * BenchBridge stands in for kwin: it hands out fake clients and settings,
+ * and collects the damage of every decoration. --decorations decorations
+ * (50 by default) are created, then every script runs for --frames frames
+ * (120 by default) of 16 ms, with the event loop running in between, so
+ * animations and delayed layouts behave as in kwin. After every frame the
+ * damaged decorations are painted into images.
+ *
+ * The results are printed as JSON: the paint time of the frames, the
+ * decorations repainted and the heap allocations per frame, and the heap
+ * memory used by one decoration.
+ */
+
+#include "fluentbenchbridge.h"
+#include "fluentbenchmark.h"
+#include "fluentdecoration.h"
+
+#include <KDecoration2/DecoratedClient>
+#include <KDecoration2/DecorationSettings>
+
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QGuiApplication>
+#include <QHoverEvent>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPainter>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <QTimer>
+
+#include <cmath>
+#include <functional>
+
+using namespace Fluent;
+
+// Duration of a frame, in milliseconds.
+static const int s_frameInterval = 16;
+
+struct Window
+{
+    Fluent::Decoration *decoration;
+    BenchClient *client;
+
+    // what kwin would keep of the decoration
+    QImage buffer;
+};
+
+class Bench
+{
+public:
+    explicit Bench(int count)
+        : m_settings(QSharedPointer<KDecoration2::DecorationSettings>::create(&m_bridge))
+    {
+        const qint64 heap = heapInUse();
+
+        for (int i = 0; i < count; ++i) {
+            const QVariantMap arguments = {
+                { QStringLiteral("bridge"), QVariant::fromValue(static_cast<KDecoration2::DecorationBridge *>(&m_bridge)) }
+            };
+
+            auto decoration = new Fluent::Decoration(nullptr, QVariantList { arguments });
+            decoration->setSettings(m_settings);
+            decoration->init();
+
+            Window window;
+            window.decoration = decoration;
+            window.client = m_bridge.client(decoration);
+            window.client->setCaption(QStringLiteral("Window %1").arg(i));
+            window.client->setSize(QSize(640 + 16 * (i % 16), 480));
+            m_windows.append(window);
+        }
+
+        // everything is painted once, as when the windows are mapped
+        m_windows.first().client->setActive(true);
+        waitForFrame();
+        paint();
+
+        m_memoryPerDecoration = heap < 0 ? -1 : (heapInUse() - heap) / count;
+    }
+
+    ~Bench()
+    {
+        for (const Window &window : qAsConst(m_windows)) {
+            delete window.decoration;
+        }
+    }
+
+    qint64 memoryPerDecoration() const
+    {
+        return m_memoryPerDecoration;
+    }
+
+    int count() const
+    {
+        return m_windows.size();
+    }
+
+    Window &window(int index)
+    {
+        return m_windows[index % m_windows.size()];
+    }
+
+    KDecoration2::DecorationSettings *settings() const
+    {
+        return m_settings.data();
+    }
+
+    // Run a script, it is called at the beginning of every frame.
+    QJsonObject run(const char *name, int frames, const std::function<void(int)> &script)
+    {
+        QVector<qreal> paintTimes;
+        QVector<qreal> repaints;
+        AllocationCounter eventAllocations;
+        AllocationCounter paintAllocations;
+
+        for (int frame = 0; frame < frames; ++frame) {
+            eventAllocations.start();
+            script(frame);
+            waitForFrame();
+            eventAllocations.stop();
+
+            QElapsedTimer timer;
+            timer.start();
+            paintAllocations.start();
+            repaints.append(paint());
+            paintAllocations.stop();
+            paintTimes.append(timer.nsecsElapsed() / 1e6);
+        }
+
+        QJsonObject result;
+        result[QStringLiteral("script")] = QLatin1String(name);
+        result[QStringLiteral("frames")] = frames;
+        result[QStringLiteral("paintMs")] = distribution(paintTimes);
+        result[QStringLiteral("repaintsPerFrame")] = distribution(repaints);
+        if (FLUENT_COUNT_ALLOCATIONS) {
+            result[QStringLiteral("eventAllocationsPerFrame")] = qreal(eventAllocations.allocations()) / frames;
+            result[QStringLiteral("eventAllocatedBytesPerFrame")] = qreal(eventAllocations.bytes()) / frames;
+            result[QStringLiteral("paintAllocationsPerFrame")] = qreal(paintAllocations.allocations()) / frames;
+            result[QStringLiteral("paintAllocatedBytesPerFrame")] = qreal(paintAllocations.bytes()) / frames;
+        }
+        return result;
+    }
+
+private:
+    // Let timers and animations run until the end of the frame.
+    void waitForFrame()
+    {
+        QEventLoop loop;
+        QTimer::singleShot(s_frameInterval, &loop, &QEventLoop::quit);
+        loop.exec();
+    }
+
+    // Paint the damage of every decoration, as kwin does, returns how many were repainted.
+    int paint()
+    {
+        int repaints = 0;
+        for (Window &window : m_windows) {
+            const QRegion damage = m_bridge.takeDamage(window.decoration);
+            if (damage.isEmpty()) {
+                continue;
+            }
+
+            const QSize size = window.decoration->size();
+            if (window.buffer.size() != size) {
+                window.buffer = QImage(size, QImage::Format_ARGB32_Premultiplied);
+                window.buffer.fill(Qt::transparent);
+            }
+
+            QPainter painter(&window.buffer);
+            painter.setRenderHint(QPainter::Antialiasing);
+            painter.setClipRegion(damage);
+            painter.setCompositionMode(QPainter::CompositionMode_Source);
+            painter.fillRect(damage.boundingRect(), Qt::transparent);
+            painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+            window.decoration->paint(&painter, damage.boundingRect());
+            ++repaints;
+        }
+        return repaints;
+    }
+
+    BenchBridge m_bridge;
+    QSharedPointer<KDecoration2::DecorationSettings> m_settings;
+    QVector<Window> m_windows;
+    qint64 m_memoryPerDecoration = -1;
+};
+
+static void hover(Window &window, QEvent::Type type, const QPointF &position, const QPointF &oldPosition)
+{
+    QHoverEvent event(type, position, oldPosition);
+    QCoreApplication::sendEvent(window.decoration, &event);
+}
+
+static int intArgument(const QStringList &arguments, const QString &name, int defaultValue)
+{
+    const int index = arguments.indexOf(name);
+    if (index < 0 || index + 1 >= arguments.size()) {
+        return defaultValue;
+    }
+
+    bool ok = false;
+    const int value = arguments.at(index + 1).toInt(&ok);
+    return ok && value > 0 ? value : defaultValue;
+}
+
+int main(int argc, char **argv)
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    // do not read nor write the configuration of the user
+    QStandardPaths::setTestModeEnabled(true);
+
+    QGuiApplication app(argc, argv);
+
+    const QStringList arguments = app.arguments();
+    const int count = intArgument(arguments, QStringLiteral("--decorations"), 50);
+    const int frames = intArgument(arguments, QStringLiteral("--frames"), 120);
+
+    Bench bench(count);
+    QJsonArray results;
+
+    // focus moves to another window every 8 frames, fades run in between
+    results.append(bench.run("activate", frames, [&bench](int frame) {
+        if (frame % 8 == 0) {
+            const int index = frame / 8;
+            bench.window(index).client->setActive(false);
+            bench.window(index + 1).client->setActive(true);
+        }
+    }));
+
+    // one window changes its caption every frame, like a progress in the title
+    results.append(bench.run("caption", frames, [&bench](int frame) {
+        bench.window(frame).client->setCaption(QStringLiteral("Downloading - %1%").arg(frame % 100));
+    }));
+
+    // the pointer sweeps over the title bar of a window, then moves to the next one
+    results.append(bench.run("hover", frames, [&bench](int frame) {
+        Window &window = bench.window(frame / 24);
+        const int width = window.decoration->size().width();
+        const QPointF position(width - (frame % 24) * width / 24.0, 15);
+        const QPointF oldPosition(width - ((frame % 24) - 1) * width / 24.0, 15);
+
+        if (frame % 24 == 0) {
+            if (frame > 0) {
+                hover(bench.window(frame / 24 - 1), QEvent::HoverLeave, QPointF(-1, -1), QPointF(0, 15));
+            }
+            hover(window, QEvent::HoverEnter, position, QPointF(-1, -1));
+        } else {
+            hover(window, QEvent::HoverMove, position, oldPosition);
+        }
+    }));
+
+    // the active window is resized, several configure events arrive per frame
+    results.append(bench.run("resize", frames, [&bench](int frame) {
+        Window &window = bench.window(0);
+        for (int step = 0; step < 4; ++step) {
+            const qreal phase = (frame * 4 + step) / 40.0;
+            window.client->setSize(QSize(800 + qRound(300 * std::sin(phase)), 600 + qRound(200 * std::cos(phase))));
+        }
+    }));
+
+    // the settings are applied every 10 frames
+    results.append(bench.run("reconfigure", frames, [&bench](int frame) {
+        if (frame % 10 == 0) {
+            emit bench.settings()->reconfigured();
+        }
+    }));
+
+    QJsonObject document;
+    document[QStringLiteral("decorations")] = bench.count();
+    document[QStringLiteral("frameIntervalMs")] = s_frameInterval;
+    document[QStringLiteral("countsAllocations")] = bool(FLUENT_COUNT_ALLOCATIONS);
+    document[QStringLiteral("memoryPerDecoration")] = bench.memoryPerDecoration() < 0 ? QJsonValue() : QJsonValue(bench.memoryPerDecoration());
+    document[QStringLiteral("results")] = results;
+
+    QTextStream(stdout) << QJsonDocument(document).toJson();
+    return 0;
+}
@@ -0,0 +1,145 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fluentanimationdriver.h"
+
+#include <KDecoration2/Decoration>
+
+#include <QHash>
+
+#include <algorithm>
+
+namespace Fluent
+{
+
+    // Interval between two frames, in milliseconds.
+    static const int s_frameInterval = 16;
+
+    //__________________________________________________________________
+    FadeAnimation::FadeAnimation( KDecoration2::Decoration *decoration, const ValueCallback &valueCallback, const RectCallback &rectCallback ):
+        m_decoration( decoration ),
+        m_valueCallback( valueCallback ),
+        m_rectCallback( rectCallback )
+    {}
+
+    //__________________________________________________________________
+    FadeAnimation::~FadeAnimation()
+    { stop(); }
+
+    //__________________________________________________________________
+    void FadeAnimation::start()
+    {
+        if( m_running ) return;
+
+        m_progress = m_direction == QAbstractAnimation::Forward ? 0 : 1;
+        m_time = AnimationDriver::self()->time();
+        m_running = true;
+        AnimationDriver::self()->add( this );
+
+        m_valueCallback( m_easingCurve.valueForProgress( m_progress ) );
+    }
+
+    //__________________________________________________________________
+    void FadeAnimation::stop()
+    {
+        if( !m_running ) return;
+
+        m_running = false;
+        AnimationDriver::self()->remove( this );
+    }
+
+    //__________________________________________________________________
+    void FadeAnimation::advance( qint64 time )
+    {
+        const qreal step = m_duration > 0 ? qreal( time - m_time )/m_duration : 1;
+        m_time = time;
+
+        if( m_direction == QAbstractAnimation::Forward )
+        {
+
+            m_progress = qMin<qreal>( m_progress + step, 1 );
+            m_running = m_progress < 1;
+
+        } else {
+
+            m_progress = qMax<qreal>( m_progress - step, 0 );
+            m_running = m_progress > 0;
+
+        }
+
+        m_valueCallback( m_easingCurve.valueForProgress( m_progress ) );
+    }
+
+    //__________________________________________________________________
+    AnimationDriver::AnimationDriver()
+    {
+        m_clock.start();
+        m_timer.setInterval( s_frameInterval );
+        m_timer.setTimerType( Qt::PreciseTimer );
+        connect( &m_timer, &QTimer::timeout, this, &AnimationDriver::tick );
+    }
+
+    //__________________________________________________________________
+    AnimationDriver *AnimationDriver::self()
+    {
+        // decorations are only animated from the gui thread
+        static AnimationDriver *s_self = new AnimationDriver();
+        return s_self;
+    }
+
+    //__________________________________________________________________
+    void AnimationDriver::add( FadeAnimation *animation )
+    {
+        m_animations.append( animation );
+        if( !m_timer.isActive() ) m_timer.start();
+    }
+
+    //__________________________________________________________________
+    void AnimationDriver::remove( FadeAnimation *animation )
+    {
+        m_animations.removeOne( animation );
+        if( m_animations.isEmpty() ) m_timer.stop();
+    }
+
+    //__________________________________________________________________
+    void AnimationDriver::tick()
+    {
+        const qint64 time = this->time();
+
+        // area to repaint in each decoration
+        QHash<KDecoration2::Decoration*, QRect> dirtyRects;
+
+        // value callbacks must not start or stop fades, finished ones are removed afterwards
+        for( FadeAnimation *animation : m_animations )
+        {
+            animation->advance( time );
+            QRect &dirtyRect( dirtyRects[animation->m_decoration] );
+            dirtyRect |= animation->m_rectCallback();
+        }
+
+        m_animations.erase( std::remove_if( m_animations.begin(), m_animations.end(),
+            []( FadeAnimation *animation ) { return !animation->isRunning(); } ),
+            m_animations.end() );
+        if( m_animations.isEmpty() ) m_timer.stop();
+
+        // one repaint per decoration and frame
+        for( auto iter = dirtyRects.constBegin(); iter != dirtyRects.constEnd(); ++iter )
+        { iter.key()->update( iter.value() ); }
+    }
+
+}
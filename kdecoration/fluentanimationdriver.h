@@ -0,0 +1,151 @@
+#ifndef FLUENT_ANIMATIONDRIVER_H
+#define FLUENT_ANIMATIONDRIVER_H
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QAbstractAnimation>
+#include <QEasingCurve>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QRect>
+#include <QTimer>
+#include <QVector>
+
+#include <functional>
+
+namespace KDecoration2
+{
+    class Decoration;
+}
+
+namespace Fluent
+{
+
+    //* fade from 0 to 1 and back, advanced by the animation driver
+    class FadeAnimation
+    {
+
+        public:
+
+        //* receives the eased value of the fade
+        using ValueCallback = std::function<void( qreal )>;
+
+        //* area of the decoration to repaint after the value changed
+        using RectCallback = std::function<QRect()>;
+
+        //* constructor
+        FadeAnimation( KDecoration2::Decoration*, const ValueCallback&, const RectCallback& );
+
+        //* destructor
+        ~FadeAnimation();
+
+        //*@name duration, in milliseconds
+        //@{
+        void setDuration( int value )
+        { m_duration = value; }
+
+        int duration() const
+        { return m_duration; }
+        //@}
+
+        //*@name direction, it can be changed while running
+        //@{
+        void setDirection( QAbstractAnimation::Direction value )
+        { m_direction = value; }
+
+        QAbstractAnimation::Direction direction() const
+        { return m_direction; }
+        //@}
+
+        //* true while the fade runs
+        bool isRunning() const
+        { return m_running; }
+
+        //* start from the beginning of the current direction, does nothing if running
+        void start();
+
+        //* stop where the fade is
+        void stop();
+
+        private:
+
+        Q_DISABLE_COPY( FadeAnimation )
+
+        friend class AnimationDriver;
+
+        //* advance to given time of the driver clock, stops at the end
+        void advance( qint64 time );
+
+        KDecoration2::Decoration *m_decoration;
+        ValueCallback m_valueCallback;
+        RectCallback m_rectCallback;
+
+        QEasingCurve m_easingCurve = QEasingCurve::InOutQuad;
+        QAbstractAnimation::Direction m_direction = QAbstractAnimation::Forward;
+        int m_duration = 250;
+
+        //* linear progress, from 0 to 1
+        qreal m_progress = 0;
+        qint64 m_time = 0;
+        bool m_running = false;
+
+    };
+
+    //* advances all running fades of all decorations from a single timer
+    class AnimationDriver: public QObject
+    {
+
+        Q_OBJECT
+
+        public:
+
+        //* singleton
+        static AnimationDriver *self();
+
+        //* clock of the driver, in milliseconds
+        qint64 time() const
+        { return m_clock.elapsed(); }
+
+        private Q_SLOTS:
+
+        //* advance all fades and repaint their decorations once
+        void tick();
+
+        private:
+
+        //* constructor
+        AnimationDriver();
+
+        friend class FadeAnimation;
+
+        //*@name running fades, the timer only runs while there are some
+        //@{
+        void add( FadeAnimation* );
+        void remove( FadeAnimation* );
+        //@}
+
+        QElapsedTimer m_clock;
+        QTimer m_timer;
+        QVector<FadeAnimation*> m_animations;
+
+    };
+
+}
+
+#endif
@@ -19,11 +19,13 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include "fluentbutton.h"
+#include "fluentbuttonglyphatlas.h"
 
 #include <KDecoration2/DecoratedClient>
 #include <KColorUtils>
 
 #include <QPainter>
+#include <QtMath>
 
 namespace Fluent
 {
@@ -36,16 +38,12 @@ namespace Fluent
     //__________________________________________________________________
     Button::Button(DecorationButtonType type, Decoration* decoration, QObject* parent)
         : DecorationButton(type, decoration, parent)
-        , m_animation( new QPropertyAnimation( this ) )
+        , m_animation( decoration,
+            // the driver repaints the button once per frame
+            [this]( qreal value ) { m_opacity = value; },
+            [this]() { return geometry().toRect(); } )
     {
 
-        // setup animation
-        m_animation->setStartValue( 0 );
-        m_animation->setEndValue( 1.0 );
-        m_animation->setTargetObject( this );
-        m_animation->setPropertyName( "opacity" );
-        m_animation->setEasingCurve( QEasingCurve::InOutQuad );
-
         // setup default geometry
         const int height = decoration->buttonHeight();
         const int width = type == DecorationButtonType::Menu ? decoration->buttonHeight() : decoration->buttonWidth();
@@ -123,15 +121,16 @@ namespace Fluent
     //__________________________________________________________________
     void Button::paint(QPainter *painter, const QRect &repaintRegion)
     {
-        Q_UNUSED(repaintRegion)
-
         if (!decoration()) return;
 
-        painter->save();
-
         // translate from offset
-        if( m_flag == FlagFirstInList ) painter->translate( m_offset );
-        else painter->translate( 0, m_offset.y() );
+        const QPointF offset = m_flag == FlagFirstInList ? QPointF( m_offset ) : QPointF( 0, m_offset.y() );
+
+        // nothing to do outside of the damaged area
+        if( repaintRegion.isValid() && !geometry().translated( offset ).intersects( repaintRegion ) ) return;
+
+        painter->save();
+        painter->translate( offset );
 
         if( !m_iconSize.isValid() ) m_iconSize = geometry().size().toSize();
 
@@ -156,281 +155,271 @@ namespace Fluent
     }
 
     //__________________________________________________________________
-    void Button::drawIcon( QPainter *painter ) const
+    // Background of the close button, rounded at the top right corner only.
+    static QPainterPath closeButtonBackground( const QSizeF& size )
     {
+        static QSizeF cachedSize;
+        static QPainterPath cachedPath;
+        if( size != cachedSize )
+        {
+            const qreal width( size.width() );
+            const qreal height( size.height() );
 
-        painter->setRenderHints( QPainter::Antialiasing );
+            QPainterPath path;
+            path.setFillRule( Qt::WindingFill );
+            path.addRoundedRect( QRectF( 0, 0, width, height ), Metrics::Frame_FrameRadius - 0.5, Metrics::Frame_FrameRadius - 0.5 );
+            path.addRect( QRect( 0, 0, 10, height) );
+            path.addRect( QRect( width - 10, 10, 10, height - 10) );
 
-        painter->translate( geometry().topLeft() );
+            cachedSize = size;
+            cachedPath = path.simplified();
+        }
+
+        return cachedPath;
+    }
+
+    //__________________________________________________________________
+    // Draw the mark of a button. The center dot of the checked on all
+    // desktops button is not part of it.
+    static void drawGlyph( QPainter *painter, DecorationButtonType type, bool checked,
+        const QColor& foregroundColor, const QSizeF& size )
+    {
 
-        const qreal height( m_iconSize.height() );
-        const qreal width( m_iconSize.width() );
+        const qreal height( size.height() );
+        const qreal width( size.width() );
         const qreal centerY( height / 2 );
         const qreal centerX( width / 2 );
 
-        // render background
-        const QColor backgroundColor( this->backgroundColor() );
+        // setup painter
+        QPen pen( foregroundColor );
+        pen.setCapStyle( Qt::FlatCap );
+        pen.setJoinStyle( Qt::MiterJoin );
+        pen.setWidthF( 1.0 );
 
-        auto d = qobject_cast<Decoration*>( decoration() );
-        bool isInactive(d && !d->client().data()->isActive()
-                        && !isHovered() && !isPressed()
-                        && m_animation->state() != QPropertyAnimation::Running);
-        QColor inactiveCol(Qt::gray);
-        if (isInactive)
-        {
-            int gray = qGray(d->titleBarColor().rgb());
-            if (gray <= 200) {
-                gray += 55;
-                gray = qMax(gray, 115);
-            }
-            else gray -= 45;
-            inactiveCol = QColor(gray, gray, gray);
-        }
+        painter->setPen( pen );
+        painter->setBrush( Qt::NoBrush );
 
-        // render mark
-        const QColor foregroundColor( this->foregroundColor() );
-        if( foregroundColor.isValid() )
+        switch( type )
         {
 
-            // setup painter
-            QPen pen( foregroundColor );
-            pen.setCapStyle( Qt::FlatCap );
-            pen.setJoinStyle( Qt::MiterJoin );
-            pen.setWidthF( 1.0 );
-
-            switch( type() )
+            case DecorationButtonType::Close:
             {
+                pen.setWidthF( 1.1 );
+                painter->setPen( pen );
 
-                case DecorationButtonType::Close:
-                {
-                    if( backgroundColor.isValid() )
-                    {
-                        painter->setPen( Qt::NoPen );
-                        painter->setBrush( backgroundColor );
-                        // painter->drawRect( QRectF( 0, 0, width, height ) );
-                        QPainterPath path;
-                        path.setFillRule( Qt::WindingFill );
-                        path.addRoundedRect( QRectF( 0, 0, width, height ), Metrics::Frame_FrameRadius - 0.5, Metrics::Frame_FrameRadius - 0.5 );
-                        path.addRect( QRect( 0, 0, 10, height) );
-                        path.addRect( QRect( width - 10, 10, 10, height - 10) );
-                        painter->drawPath( path.simplified() );
-                    }
-                    pen.setWidthF( 1.1 );
-                    painter->setPen( pen );
-                    painter->setBrush( Qt::NoBrush );
-
-                    painter->drawLine( QPointF( centerX - 5, centerY - 5 ), QPointF( centerX + 5, centerY + 5 ) );
-                    painter->drawLine( QPointF( centerX - 5, centerY + 5 ), QPointF( centerX + 5, centerY - 5 ) );
-                    pen.setWidthF( 1.0 );
-                    break;
-                }
-
-                case DecorationButtonType::Maximize:
-                {
-                    if( backgroundColor.isValid() )
-                    {
-                        painter->setPen( Qt::NoPen );
-                        painter->setBrush( backgroundColor );
-                        painter->drawRect( QRectF( 0, 0, width, height ) );
-                    }
-
-                    painter->setPen( pen );
-                    painter->setBrush( Qt::NoBrush );
-
-                    if (isChecked())
-                    {
-                        painter->drawRect(QRectF(centerX - 5, centerY - 2.5, 7.0, 7.0));
-                        painter->drawPolyline(QPolygonF()
-                                                << QPointF(centerX - 3, centerY - 2.5)
-                                                << QPointF(centerX - 3, centerY - 4.5)
-                                                << QPointF(centerX + 4, centerY - 4.5)
-                                                << QPointF(centerX + 4, centerY + 2.5)
-                                                << QPointF(centerX + 3, centerY + 2.5));
-                    }
-                    else {
-                        painter->drawRect(QRectF(centerX - 5, centerY - 4.5, 9.0, 9.0));
-                    }
-
-                    break;
-                }
+                painter->drawLine( QPointF( centerX - 5, centerY - 5 ), QPointF( centerX + 5, centerY + 5 ) );
+                painter->drawLine( QPointF( centerX - 5, centerY + 5 ), QPointF( centerX + 5, centerY - 5 ) );
+                break;
+            }
 
-                case DecorationButtonType::Minimize:
+            case DecorationButtonType::Maximize:
+            {
+                if( checked )
                 {
-                    if( backgroundColor.isValid() )
-                    {
-                        painter->setPen( Qt::NoPen );
-                        painter->setBrush( backgroundColor );
-                        painter->drawRect( QRectF( 0, 0, width, height ) );
-                    }
-
-                    painter->setPen( pen );
-                    painter->setBrush( Qt::NoBrush );
-
-                    painter->drawLine( QPointF( centerX - 5, centerY + 0.5 ), QPointF( centerX + 5, centerY + 0.5 ) );
-
-                    break;
+                    painter->drawRect(QRectF(centerX - 5, centerY - 2.5, 7.0, 7.0));
+                    painter->drawPolyline(QPolygonF()
+                                            << QPointF(centerX - 3, centerY - 2.5)
+                                            << QPointF(centerX - 3, centerY - 4.5)
+                                            << QPointF(centerX + 4, centerY - 4.5)
+                                            << QPointF(centerX + 4, centerY + 2.5)
+                                            << QPointF(centerX + 3, centerY + 2.5));
                 }
-
-                case DecorationButtonType::OnAllDesktops:
-                {
-                    painter->setPen( Qt::NoPen );
-                    if( backgroundColor.isValid() )
-                    {
-                        painter->setBrush( backgroundColor );
-                        painter->drawRect( QRectF( 0, 0, width, height ) );
-                    }
-                    painter->setBrush( foregroundColor );
-
-                    if( isChecked()) {
-
-                        // outer ring
-                        painter->drawRect( QRectF( 16, 9, 12, 12 ) );
-
-                        // center dot
-                        QColor backgroundColor( this->backgroundColor() );
-                        if( !backgroundColor.isValid() && d ) backgroundColor = d->titleBarColor();
-
-                        if( backgroundColor.isValid() )
-                        {
-                            painter->setBrush( backgroundColor );
-                            painter->drawRect( QRectF( 21, 14, 2, 2 ) );
-                        }
-
-                    } else {
-
-                        painter->drawPolygon( QPolygonF()
-                            << QPointF( 19.5, 14.5 )
-                            << QPointF( 25, 9 )
-                            << QPointF( 28, 12 )
-                            << QPointF( 22.5, 17.5 ) );
-
-                        painter->setPen( pen );
-                        painter->drawLine( QPointF( 18.5, 13.5 ), QPointF( 23.5, 18.5 ) );
-                        painter->drawLine( QPointF( 25, 12 ), QPointF( 17.5, 19.5 ) );
-                    }
-                    break;
+                else {
+                    painter->drawRect(QRectF(centerX - 5, centerY - 4.5, 9.0, 9.0));
                 }
 
-                case DecorationButtonType::Shade:
-                {
-                    if( backgroundColor.isValid() )
-                    {
-                        painter->setPen( Qt::NoPen );
-                        painter->setBrush( backgroundColor );
-                        painter->drawRect( QRectF( 0, 0, width, height ) );
-                    }
-                    painter->setPen( pen );
-                    painter->setBrush( Qt::NoBrush );
-
-                    painter->drawLine( 18, 12, 26, 12 );
-                    if (isChecked()) {
-                        painter->drawPolyline( QPolygonF()
-                            << QPointF( 18, 15 )
-                            << QPointF( 22, 19 )
-                            << QPointF( 26, 15 ) );
+                break;
+            }
 
-                    } else {
-                        painter->drawPolyline( QPolygonF()
-                            << QPointF( 18, 19 )
-                            << QPointF( 22, 15 )
-                            << QPointF( 26, 19 ) );
-                    }
+            case DecorationButtonType::Minimize:
+            {
+                painter->drawLine( QPointF( centerX - 5, centerY + 0.5 ), QPointF( centerX + 5, centerY + 0.5 ) );
+                break;
+            }
 
-                    break;
+            case DecorationButtonType::OnAllDesktops:
+            {
+                painter->setPen( Qt::NoPen );
+                painter->setBrush( foregroundColor );
 
-                }
+                if( checked ) {
 
-                case DecorationButtonType::KeepBelow:
-                {
-                    if( backgroundColor.isValid() )
-                    {
-                        painter->setPen( Qt::NoPen );
-                        painter->setBrush( backgroundColor );
-                        painter->drawRect( QRectF( 0, 0, width, height ) );
-                    }
-                    painter->setPen( pen );
-                    painter->setBrush( Qt::NoBrush );
+                    // outer ring
+                    painter->drawRect( QRectF( 16, 9, 12, 12 ) );
 
-                    painter->drawPolyline( QPolygonF()
-                        << QPointF( 18, 11 )
-                        << QPointF( 22, 15 )
-                        << QPointF( 26, 11 ) );
+                } else {
 
-                    painter->drawPolyline( QPolygonF()
-                        << QPointF( 18, 15 )
-                        << QPointF( 22, 19 )
-                        << QPointF( 26, 15 ) );
-                    break;
+                    painter->drawPolygon( QPolygonF()
+                        << QPointF( 19.5, 14.5 )
+                        << QPointF( 25, 9 )
+                        << QPointF( 28, 12 )
+                        << QPointF( 22.5, 17.5 ) );
 
-                }
-
-                case DecorationButtonType::KeepAbove:
-                {
-                    if( backgroundColor.isValid() )
-                    {
-                        painter->setPen( Qt::NoPen );
-                        painter->setBrush( backgroundColor );
-                        painter->drawRect( QRectF( 0, 0, width, height ) );
-                    }
                     painter->setPen( pen );
-                    painter->setBrush( Qt::NoBrush );
+                    painter->drawLine( QPointF( 18.5, 13.5 ), QPointF( 23.5, 18.5 ) );
+                    painter->drawLine( QPointF( 25, 12 ), QPointF( 17.5, 19.5 ) );
+                }
+                break;
+            }
 
+            case DecorationButtonType::Shade:
+            {
+                painter->drawLine( 18, 12, 26, 12 );
+                if( checked ) {
                     painter->drawPolyline( QPolygonF()
                         << QPointF( 18, 15 )
-                        << QPointF( 22, 11 )
+                        << QPointF( 22, 19 )
                         << QPointF( 26, 15 ) );
 
+                } else {
                     painter->drawPolyline( QPolygonF()
                         << QPointF( 18, 19 )
                         << QPointF( 22, 15 )
                         << QPointF( 26, 19 ) );
-                    break;
                 }
 
+                break;
 
-                case DecorationButtonType::ApplicationMenu:
-                {
-                    if( backgroundColor.isValid() )
-                    {
-                        painter->setPen( Qt::NoPen );
-                        painter->setBrush( backgroundColor );
-                        painter->drawRect( QRectF( 0, 0, width, height ) );
-                    }
-                    painter->setPen( pen );
-                    painter->setBrush( Qt::NoBrush );
+            }
 
-                    painter->drawLine( QPointF( centerX - 8, centerY - 3.5 ), QPointF( centerX + 8, centerY - 3.5 ) );
-                    painter->drawLine( QPointF( centerX - 8, centerY + 0.5 ), QPointF( centerX + 8, centerY + 0.5 ) );
-                    painter->drawLine( QPointF( centerX - 8, centerY + 4.5 ), QPointF( centerX + 8, centerY + 4.5 ) );
-                    break;
-                }
+            case DecorationButtonType::KeepBelow:
+            {
+                painter->drawPolyline( QPolygonF()
+                    << QPointF( 18, 11 )
+                    << QPointF( 22, 15 )
+                    << QPointF( 26, 11 ) );
+
+                painter->drawPolyline( QPolygonF()
+                    << QPointF( 18, 15 )
+                    << QPointF( 22, 19 )
+                    << QPointF( 26, 15 ) );
+                break;
 
-                case DecorationButtonType::ContextHelp:
-                {
-                    if( backgroundColor.isValid() )
-                    {
-                        painter->setPen( Qt::NoPen );
-                        painter->setBrush( backgroundColor );
-                        painter->drawRect( QRectF( 0, 0, width, height ) );
-                    }
-                    painter->setPen( pen );
-                    painter->setBrush( Qt::NoBrush );
+            }
 
-                    QPainterPath path;
-                    path.moveTo( 18, 12 );
-                    path.arcTo( QRectF( 18, 9.5, 8, 5 ), 180, -180 );
-                    path.cubicTo( QPointF(26.5, 15.5), QPointF( 22, 13.5 ), QPointF( 22, 17.5 ) );
-                    painter->drawPath( path );
+            case DecorationButtonType::KeepAbove:
+            {
+                painter->drawPolyline( QPolygonF()
+                    << QPointF( 18, 15 )
+                    << QPointF( 22, 11 )
+                    << QPointF( 26, 15 ) );
+
+                painter->drawPolyline( QPolygonF()
+                    << QPointF( 18, 19 )
+                    << QPointF( 22, 15 )
+                    << QPointF( 26, 19 ) );
+                break;
+            }
 
-                    painter->drawPoint( 22, 21 );
+            case DecorationButtonType::ApplicationMenu:
+            {
+                painter->drawLine( QPointF( centerX - 8, centerY - 3.5 ), QPointF( centerX + 8, centerY - 3.5 ) );
+                painter->drawLine( QPointF( centerX - 8, centerY + 0.5 ), QPointF( centerX + 8, centerY + 0.5 ) );
+                painter->drawLine( QPointF( centerX - 8, centerY + 4.5 ), QPointF( centerX + 8, centerY + 4.5 ) );
+                break;
+            }
 
-                    break;
-                }
+            case DecorationButtonType::ContextHelp:
+            {
+                QPainterPath path;
+                path.moveTo( 18, 12 );
+                path.arcTo( QRectF( 18, 9.5, 8, 5 ), 180, -180 );
+                path.cubicTo( QPointF(26.5, 15.5), QPointF( 22, 13.5 ), QPointF( 22, 17.5 ) );
+                painter->drawPath( path );
 
-                default: break;
+                painter->drawPoint( 22, 21 );
 
+                break;
             }
 
+            default: break;
+
+        }
+
+    }
+
+    //__________________________________________________________________
+    void Button::drawIcon( QPainter *painter ) const
+    {
+
+        switch( type() )
+        {
+            case DecorationButtonType::Close:
+            case DecorationButtonType::Maximize:
+            case DecorationButtonType::Minimize:
+            case DecorationButtonType::OnAllDesktops:
+            case DecorationButtonType::Shade:
+            case DecorationButtonType::KeepBelow:
+            case DecorationButtonType::KeepAbove:
+            case DecorationButtonType::ApplicationMenu:
+            case DecorationButtonType::ContextHelp:
+            break;
+
+            default: return;
+        }
+
+        const QColor foregroundColor( this->foregroundColor() );
+        if( !foregroundColor.isValid() ) return;
+
+        painter->setRenderHints( QPainter::Antialiasing );
+
+        painter->translate( geometry().topLeft() );
+
+        const QSizeF size( m_iconSize );
+
+        // render background, it changes with every frame of the hover animation
+        const QColor backgroundColor( this->backgroundColor() );
+        if( backgroundColor.isValid() )
+        {
+            painter->setPen( Qt::NoPen );
+            painter->setBrush( backgroundColor );
+            if( type() == DecorationButtonType::Close ) painter->drawPath( closeButtonBackground( size ) );
+            else painter->drawRect( QRectF( QPointF( 0, 0 ), size ) );
+        }
+
+        // the center dot of the on all desktops button is drawn with the background color
+        QColor glyphBackgroundColor;
+        if( type() == DecorationButtonType::OnAllDesktops && isChecked() )
+        {
+            glyphBackgroundColor = backgroundColor;
+            auto d = qobject_cast<Decoration*>( decoration() );
+            if( !glyphBackgroundColor.isValid() && d ) glyphBackgroundColor = d->titleBarColor();
+        }
+
+        // render mark, from the glyph atlas, tinted with the foreground color
+        const qreal devicePixelRatio = painter->device()->devicePixelRatioF();
+        const ButtonGlyphAtlas::Key key = {
+            type(),
+            isChecked(),
+            m_iconSize,
+            devicePixelRatio };
+
+        QImage glyph( ButtonGlyphAtlas::self()->glyph( key, foregroundColor ) );
+        if( glyph.isNull() )
+        {
+
+            QImage mask( QSize( qCeil( size.width()*devicePixelRatio ), qCeil( size.height()*devicePixelRatio ) ), QImage::Format_ARGB32_Premultiplied );
+            mask.setDevicePixelRatio( devicePixelRatio );
+            mask.fill( Qt::transparent );
+
+            QPainter maskPainter( &mask );
+            maskPainter.setRenderHints( QPainter::Antialiasing );
+            drawGlyph( &maskPainter, type(), isChecked(), Qt::black, size );
+            maskPainter.end();
+
+            ButtonGlyphAtlas::self()->insert( key, mask );
+            glyph = ButtonGlyphAtlas::self()->glyph( key, foregroundColor );
+
+        }
+
+        painter->drawImage( QPointF( 0, 0 ), glyph );
+
+        // center dot, over the ring
+        if( glyphBackgroundColor.isValid() )
+        {
+            painter->setPen( Qt::NoPen );
+            painter->setBrush( glyphBackgroundColor );
+            painter->drawRect( QRectF( 21, 14, 2, 2 ) );
         }
 
     }
@@ -447,7 +436,7 @@ namespace Fluent
 
             return d->titleBarColor();
 
-        } else if( m_animation->state() == QPropertyAnimation::Running && type() == DecorationButtonType::Close ) {
+        } else if( m_animation.isRunning() && type() == DecorationButtonType::Close ) {
 
             return KColorUtils::mix( d->fontColor(), Qt::white, m_opacity );
 
@@ -482,7 +471,7 @@ namespace Fluent
 
             return d->fontColor();
 
-        } else if( m_animation->state() == QPropertyAnimation::Running ) {
+        } else if( m_animation.isRunning() ) {
 
             if( type() == DecorationButtonType::Close ) return KColorUtils::mix( d->titleBarColor(), Qt::red, m_opacity );
             else {
@@ -512,7 +501,7 @@ namespace Fluent
 
         // animation
         auto d = qobject_cast<Decoration*>(decoration());
-        if( d )  m_animation->setDuration( d->internalSettings()->animationsDuration() );
+        if( d )  m_animation.setDuration( d->internalSettings()->animationsDuration() );
 
     }
 
@@ -523,11 +512,11 @@ namespace Fluent
         auto d = qobject_cast<Decoration*>(decoration());
         if( !(d && d->internalSettings()->animationsEnabled() ) ) return;
 
-        QAbstractAnimation::Direction dir = hovered ? QPropertyAnimation::Forward : QPropertyAnimation::Backward;
-        if( m_animation->state() == QPropertyAnimation::Running && m_animation->direction() != dir )
-            m_animation->stop();
-        m_animation->setDirection( dir );
-        if( m_animation->state() != QPropertyAnimation::Running ) m_animation->start();
+        QAbstractAnimation::Direction dir = hovered ? QAbstractAnimation::Forward : QAbstractAnimation::Backward;
+        if( m_animation.isRunning() && m_animation.direction() != dir )
+            m_animation.stop();
+        m_animation.setDirection( dir );
+        if( !m_animation.isRunning() ) m_animation.start();
 
     }
 
@@ -26,7 +26,6 @@
 
 #include <QHash>
 #include <QImage>
-#include <QPropertyAnimation>
 
 namespace Fluent
 {
@@ -122,8 +121,8 @@ namespace Fluent
 
         Flag m_flag = FlagNone;
 
-        //* active state change animation
-        QPropertyAnimation *m_animation;
+        //* hover animation
+        FadeAnimation m_animation;
 
         //* vertical offset (for rendering)
         QPointF m_offset;
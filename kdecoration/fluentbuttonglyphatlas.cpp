@@ -0,0 +1,97 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fluentbuttonglyphatlas.h"
+
+#include <QPainter>
+
+namespace Fluent
+{
+
+    ButtonGlyphAtlas *ButtonGlyphAtlas::s_self = nullptr;
+
+    // Enough for the glyphs of every button at a few scales.
+    static const int s_glyphAtlasCost = 2 * 1024 * 1024;
+
+    //__________________________________________________________________
+    // The mask, filled with the given color.
+    static QImage tintedGlyph( const QImage& mask, const QColor& color )
+    {
+        QImage image( mask.size(), QImage::Format_ARGB32_Premultiplied );
+        image.setDevicePixelRatio( mask.devicePixelRatio() );
+        image.fill( color );
+
+        QPainter painter( &image );
+        painter.setCompositionMode( QPainter::CompositionMode_DestinationIn );
+        painter.drawImage( QPointF( 0, 0 ), mask );
+        painter.end();
+
+        return image;
+    }
+
+    //__________________________________________________________________
+    ButtonGlyphAtlas::ButtonGlyphAtlas():
+        m_glyphs( s_glyphAtlasCost )
+    {}
+
+    //__________________________________________________________________
+    ButtonGlyphAtlas::~ButtonGlyphAtlas()
+    { s_self = nullptr; }
+
+    //__________________________________________________________________
+    ButtonGlyphAtlas *ButtonGlyphAtlas::self()
+    {
+        // buttons are only painted from the gui thread
+        if( !s_self )
+        { s_self = new ButtonGlyphAtlas(); }
+
+        return s_self;
+    }
+
+    //__________________________________________________________________
+    QImage ButtonGlyphAtlas::glyph( const Key& key, const QColor& color )
+    {
+        Glyph *glyph = m_glyphs.object( key );
+        if( !glyph ) return QImage();
+
+        // only fades change the color, tinting is a fill and a blend, not a rasterization
+        if( glyph->tinted.isNull() || glyph->color != color.rgba() )
+        {
+            glyph->tinted = tintedGlyph( glyph->mask, color );
+            glyph->color = color.rgba();
+        }
+
+        return glyph->tinted;
+    }
+
+    //__________________________________________________________________
+    void ButtonGlyphAtlas::insert( const Key& key, const QImage& mask )
+    {
+        Glyph *glyph = new Glyph;
+        glyph->mask = mask;
+        glyph->color = 0;
+
+        // the mask and its tinted copy
+        m_glyphs.insert( key, glyph, 2*mask.byteCount() );
+    }
+
+    //__________________________________________________________________
+    void ButtonGlyphAtlas::clear()
+    { m_glyphs.clear(); }
+
+}
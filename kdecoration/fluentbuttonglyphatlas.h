@@ -0,0 +1,104 @@
+#ifndef FLUENT_BUTTONGLYPHATLAS_H
+#define FLUENT_BUTTONGLYPHATLAS_H
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <KDecoration2/DecorationButton>
+
+#include <QCache>
+#include <QColor>
+#include <QHash>
+#include <QImage>
+#include <QSize>
+
+namespace Fluent
+{
+
+    //* pre-rasterized button glyphs, shared by all decorations
+    //* glyphs are stored as masks and tinted when they are used, so color fades reuse them
+    class ButtonGlyphAtlas
+    {
+
+        public:
+
+        //* what a glyph looks like, except for its color
+        struct Key
+        {
+            KDecoration2::DecorationButtonType type;
+            bool checked;
+            QSize iconSize;
+            qreal devicePixelRatio;
+
+            bool operator == ( const Key& other ) const
+            {
+                return type == other.type
+                    && checked == other.checked
+                    && iconSize == other.iconSize
+                    && devicePixelRatio == other.devicePixelRatio;
+            }
+        };
+
+        //* destructor
+        ~ButtonGlyphAtlas();
+
+        //* singleton
+        static ButtonGlyphAtlas *self();
+
+        //* glyph for given key, tinted with given color, null image if it is not rasterized yet
+        QImage glyph( const Key&, const QColor& );
+
+        //* store a rasterized glyph mask, only its alpha channel is used
+        void insert( const Key&, const QImage& );
+
+        //* drop all glyphs, on reconfiguration
+        void clear();
+
+        private:
+
+        //* constructor
+        ButtonGlyphAtlas();
+
+        //* glyph mask, and the glyph tinted with the last color it was used with
+        struct Glyph
+        {
+            QImage mask;
+            QImage tinted;
+            QRgb color;
+        };
+
+        //* glyphs, the cost is in bytes
+        QCache<Key, Glyph> m_glyphs;
+
+        //* singleton
+        static ButtonGlyphAtlas *s_self;
+
+    };
+
+    inline uint qHash( const ButtonGlyphAtlas::Key& key, uint seed = 0 )
+    {
+        seed = ::qHash( static_cast<int>( key.type ), seed );
+        seed = ::qHash( key.checked, seed );
+        seed = ::qHash( key.iconSize.width(), seed );
+        seed = ::qHash( key.iconSize.height(), seed );
+        return ::qHash( key.devicePixelRatio, seed );
+    }
+
+}
+
+#endif
@@ -30,6 +30,8 @@
 #include "fluentbutton.h"
 
 #include "fluentboxshadowrenderer.h"
+#include "fluentshadowcache.h"
+#include "fluentshadowparams.h"
 
 #include <KDecoration2/DecoratedClient>
 #include <KDecoration2/DecorationButtonGroup>
@@ -41,14 +43,12 @@
 #include <KSharedConfig>
 #include <KPluginFactory>
 
+#include <QFutureWatcher>
+#include <QLoggingCategory>
 #include <QPainter>
 #include <QTextStream>
 #include <QTimer>
 
-#if FLUENT_HAVE_X11
-#include <QX11Info>
-#endif
-
 #include <cmath>
 
 K_PLUGIN_FACTORY_WITH_JSON(
@@ -61,85 +61,7 @@ K_PLUGIN_FACTORY_WITH_JSON(
 
 namespace
 {
-    struct ShadowParams {
-        ShadowParams()
-            : offset(QPoint(0, 0))
-            , radius(0)
-            , opacity(0) {}
-
-        ShadowParams(const QPoint &offset, int radius, qreal opacity)
-            : offset(offset)
-            , radius(radius)
-            , opacity(opacity) {}
-
-        QPoint offset;
-        int radius;
-        qreal opacity;
-    };
-
-    struct CompositeShadowParams {
-        CompositeShadowParams() = default;
-
-        CompositeShadowParams(
-                const QPoint &offset,
-                const ShadowParams &shadow1,
-                const ShadowParams &shadow2)
-            : offset(offset)
-            , shadow1(shadow1)
-            , shadow2(shadow2) {}
-
-        bool isNone() const {
-            return qMax(shadow1.radius, shadow2.radius) == 0;
-        }
-
-        QPoint offset;
-        ShadowParams shadow1;
-        ShadowParams shadow2;
-    };
-
-    const CompositeShadowParams s_shadowParams[] = {
-        // None
-        CompositeShadowParams(),
-        // Small
-        CompositeShadowParams(
-            QPoint(0, 4),
-            ShadowParams(QPoint(0, 0), 16, 1),
-            ShadowParams(QPoint(0, -2), 8, 0.4)),
-        // Medium
-        CompositeShadowParams(
-            QPoint(0, 8),
-            ShadowParams(QPoint(0, 0), 32, 0.9),
-            ShadowParams(QPoint(0, -4), 16, 0.3)),
-        // Large
-        CompositeShadowParams(
-            QPoint(0, 12),
-            ShadowParams(QPoint(0, 0), 48, 0.8),
-            ShadowParams(QPoint(0, -6), 24, 0.2)),
-        // Very large
-        CompositeShadowParams(
-            QPoint(0, 16),
-            ShadowParams(QPoint(0, 0), 64, 0.7),
-            ShadowParams(QPoint(0, -8), 32, 0.1)),
-    };
-
-    inline CompositeShadowParams lookupShadowParams(int size)
-    {
-        switch (size) {
-        case Fluent::InternalSettings::ShadowNone:
-            return s_shadowParams[0];
-        case Fluent::InternalSettings::ShadowSmall:
-            return s_shadowParams[1];
-        case Fluent::InternalSettings::ShadowMedium:
-            return s_shadowParams[2];
-        case Fluent::InternalSettings::ShadowLarge:
-            return s_shadowParams[3];
-        case Fluent::InternalSettings::ShadowVeryLarge:
-            return s_shadowParams[4];
-        default:
-            // Fallback to the Large size.
-            return s_shadowParams[3];
-        }
-    }
+    Q_LOGGING_CATEGORY(FLUENT_DECORATION, "fluent.decoration", QtWarningMsg)
 }
 
 namespace Fluent
@@ -155,13 +77,85 @@ namespace Fluent
     static int g_shadowStrength = 255;
     static QColor g_shadowColor = Qt::black;
     static QSharedPointer<KDecoration2::DecorationShadow> g_sShadow;
+    static int g_shadowGeneration = 0;
+
+    // Shadows larger than this many pixels are rendered in the background.
+    static const int s_asyncShadowArea = 512 * 512;
+
+    // The placeholder of a shadow rendered in the background is rendered at
+    // a resolution that keeps its blur radii at least this large.
+    static const int s_placeholderBlurRadius = 8;
+
+    static Decoration::TitleBarCacheStatistics g_titleBarCacheStatistics;
+
+    // Title bar cache statistics are logged every this many title bar paints.
+    static const quint64 s_titleBarCacheReportInterval = 1024;
+
+    // Layouts are coalesced to at most one per this many milliseconds.
+    static const int s_layoutInterval = 16;
+
+    //________________________________________________________________
+    // Mask out the area below the window and draw the window outline,
+    // returns the padding of the shadow.
+    static QMargins maskShadowTexture(QImage &shadowTexture, const QSize &boxSize,
+        const CompositeShadowParams &params, const QColor &outlineColor)
+    {
+        QPainter painter(&shadowTexture);
+        painter.setRenderHint(QPainter::Antialiasing);
+
+        const QRect outerRect = shadowTexture.rect();
+
+        QRect boxRect(QPoint(0, 0), boxSize);
+        boxRect.moveCenter(outerRect.center());
+
+        // Mask out inner rect.
+        const QMargins padding = QMargins(
+            boxRect.left() - outerRect.left() - Metrics::Shadow_Overlap - params.offset.x(),
+            boxRect.top() - outerRect.top() - Metrics::Shadow_Overlap - params.offset.y(),
+            outerRect.right() - boxRect.right() - Metrics::Shadow_Overlap + params.offset.x(),
+            outerRect.bottom() - boxRect.bottom() - Metrics::Shadow_Overlap + params.offset.y());
+        const QRect innerRect = outerRect - padding;
+
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(Qt::black);
+        painter.setCompositionMode(QPainter::CompositionMode_DestinationOut);
+        painter.drawRoundedRect(
+            innerRect,
+            Metrics::Frame_FrameRadius + 0.5,
+            Metrics::Frame_FrameRadius + 0.5);
+
+        // Draw outline.
+        painter.setPen(outlineColor);
+        painter.setBrush(Qt::NoBrush);
+        painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+        painter.drawRoundedRect(
+            innerRect,
+            Metrics::Frame_FrameRadius - 0.5,
+            Metrics::Frame_FrameRadius - 0.5);
+
+        return padding;
+    }
 
     //________________________________________________________________
     Decoration::Decoration(QObject *parent, const QVariantList &args)
         : KDecoration2::Decoration(parent, args)
-        , m_animation( new QPropertyAnimation( this ) )
+        , m_animation( this,
+            [this]( qreal value )
+            {
+                // the driver repaints the decoration once per frame
+                m_opacity = value;
+                invalidateTitleBarCache();
+            },
+            [this]() { return rect(); } )
     {
         g_sDecoCount++;
+
+        // kwin is the process that renders most shadows, and keeps running
+        // long enough to write them for the others
+        ShadowCache::self()->setDiskCacheWritable(true);
+
+        m_layoutTimer.setSingleShot( true );
+        connect( &m_layoutTimer, &QTimer::timeout, this, &Decoration::updateLayout );
     }
 
     //________________________________________________________________
@@ -179,6 +173,7 @@ namespace Fluent
     {
         if( m_opacity == value ) return;
         m_opacity = value;
+        invalidateTitleBarCache();
         update();
     }
 
@@ -188,7 +183,7 @@ namespace Fluent
 
         auto c = client().data();
         if( hideTitleBar() ) return c->color( ColorGroup::Inactive, ColorRole::TitleBar );
-        else if( m_animation->state() == QPropertyAnimation::Running )
+        else if( m_animation.isRunning() )
         {
             return KColorUtils::mix(
                 c->color( ColorGroup::Inactive, ColorRole::TitleBar ),
@@ -203,7 +198,7 @@ namespace Fluent
     {
 
         auto c = client().data();
-        if( m_animation->state() == QPropertyAnimation::Running )
+        if( m_animation.isRunning() )
         {
             return KColorUtils::mix(
                 c->color( ColorGroup::Inactive, ColorRole::Foreground ),
@@ -218,13 +213,6 @@ namespace Fluent
     {
         auto c = client().data();
 
-        // active state change animation
-        m_animation->setStartValue( 0 );
-        m_animation->setEndValue( 1.0 );
-        m_animation->setTargetObject( this );
-        m_animation->setPropertyName( "opacity" );
-        m_animation->setEasingCurve( QEasingCurve::InOutQuad );
-
         reconfigure();
         updateTitleBar();
         auto s = settings();
@@ -238,9 +226,9 @@ namespace Fluent
         connect(s.data(), &KDecoration2::DecorationSettings::decorationButtonsLeftChanged, this, &Decoration::updateButtonsGeometryDelayed);
         connect(s.data(), &KDecoration2::DecorationSettings::decorationButtonsRightChanged, this, &Decoration::updateButtonsGeometryDelayed);
 
-        // full reconfiguration
-        connect(s.data(), &KDecoration2::DecorationSettings::reconfigured, this, &Decoration::reconfigure);
+        // full reconfiguration, the provider publishes the new settings before the decoration reads them
         connect(s.data(), &KDecoration2::DecorationSettings::reconfigured, SettingsProvider::self(), &SettingsProvider::reconfigure, Qt::UniqueConnection );
+        connect(s.data(), &KDecoration2::DecorationSettings::reconfigured, this, &Decoration::reconfigure);
         connect(s.data(), &KDecoration2::DecorationSettings::reconfigured, this, &Decoration::updateButtonsGeometryDelayed);
 
         connect(c, &KDecoration2::DecoratedClient::adjacentScreenEdgesChanged, this, &Decoration::recalculateBorders);
@@ -251,20 +239,28 @@ namespace Fluent
             [this]()
             {
                 // update the caption area
+                invalidateTitleBarCache();
                 update(titleBar());
             }
         );
 
+        // the cached title bar depends on these, everything else that changes
+        // its geometry goes through recalculateBorders or updateButtonsGeometry
+        connect(c, &KDecoration2::DecoratedClient::activeChanged, this, &Decoration::invalidateTitleBarCache);
+        connect(c, &KDecoration2::DecoratedClient::paletteChanged, this, &Decoration::invalidateTitleBarCache);
+        connect(s.data(), &KDecoration2::DecorationSettings::alphaChannelSupportedChanged, this, &Decoration::invalidateTitleBarCache);
+
         connect(c, &KDecoration2::DecoratedClient::activeChanged, this, &Decoration::updateAnimationState);
-        connect(c, &KDecoration2::DecoratedClient::widthChanged, this, &Decoration::updateTitleBar);
+        // width changes come in bursts during interactive resizes, the layout follows at most once per frame
+        connect(c, &KDecoration2::DecoratedClient::widthChanged, this, &Decoration::scheduleLayout);
         connect(c, &KDecoration2::DecoratedClient::maximizedChanged, this, &Decoration::updateTitleBar);
         // connect(c, &KDecoration2::DecoratedClient::maximizedChanged, this, &Decoration::setOpaque);
 
-        connect(c, &KDecoration2::DecoratedClient::widthChanged, this, &Decoration::updateButtonsGeometry);
         connect(c, &KDecoration2::DecoratedClient::maximizedChanged, this, &Decoration::updateButtonsGeometry);
         connect(c, &KDecoration2::DecoratedClient::adjacentScreenEdgesChanged, this, &Decoration::updateButtonsGeometry);
         connect(c, &KDecoration2::DecoratedClient::shadedChanged, this, &Decoration::updateButtonsGeometry);
 
+
         createButtons();
         createShadow();
     }
@@ -283,8 +279,8 @@ namespace Fluent
         {
 
             auto c = client().data();
-            m_animation->setDirection( c->isActive() ? QPropertyAnimation::Forward : QPropertyAnimation::Backward );
-            if( m_animation->state() != QPropertyAnimation::Running ) m_animation->start();
+            m_animation.setDirection( c->isActive() ? QAbstractAnimation::Forward : QAbstractAnimation::Backward );
+            if( !m_animation.isRunning() ) m_animation.start();
 
         } else {
 
@@ -297,10 +293,10 @@ namespace Fluent
     void Decoration::reconfigure()
     {
 
-        m_internalSettings = SettingsProvider::self()->internalSettings( this );
+        m_internalSettings = SettingsProvider::self()->internalSettings( this, m_settingsCache );
 
         // animation
-        m_animation->setDuration( m_internalSettings->animationsDuration() );
+        m_animation.setDuration( m_internalSettings->animationsDuration() );
 
         // borders
         recalculateBorders();
@@ -321,6 +317,7 @@ namespace Fluent
         }
 
         setBorders(QMargins(0, top, 0, 0));
+        invalidateTitleBarCache();
 
         // extended sizes
         const int extSize = s->largeSpacing();
@@ -342,8 +339,22 @@ namespace Fluent
     //________________________________________________________________
     void Decoration::updateButtonsGeometry()
     {
-        const auto s = settings();
+        // this covers a pending layout
+        if( m_layoutPending ) updateTitleBar();
+        m_layoutPending = false;
+        m_layoutTimer.stop();
+
+        layoutButtons();
+        m_layoutWidth = size().width();
 
+        // the caption rect depends on the button positions
+        invalidateTitleBarCache();
+        update();
+    }
+
+    //________________________________________________________________
+    void Decoration::layoutButtons()
+    {
         // adjust button position
         const int bHeight = buttonHeight();
         foreach( const QPointer<KDecoration2::DecorationButton>& button, m_leftButtons->buttons() + m_rightButtons->buttons() )
@@ -374,72 +385,204 @@ namespace Fluent
 
         }
 
-        update();
+    }
+
+    //________________________________________________________________
+    void Decoration::scheduleLayout()
+    {
+        m_layoutPending = true;
+        if( m_layoutTimer.isActive() ) return;
+
+        // at most one layout per frame
+        const qint64 elapsed = m_lastLayout.isValid() ? m_lastLayout.elapsed() : s_layoutInterval;
+        m_layoutTimer.start( qMax<qint64>( 0, s_layoutInterval - elapsed ) );
+    }
+
+    //________________________________________________________________
+    void Decoration::updateLayout()
+    {
+        if( !m_layoutPending ) return;
+        m_layoutPending = false;
+        m_layoutTimer.stop();
+        m_lastLayout.start();
+        ++m_layoutStatistics.layouts;
+
+        const int oldWidth = m_layoutWidth;
+        const int newWidth = size().width();
+        m_layoutWidth = newWidth;
+
+        const QRect oldRightButtons = m_rightButtons->geometry().toAlignedRect();
+        const QRect oldCaption = captionTextRect();
+
+        // only the width changed: the title bar follows it, and the right buttons move
+        updateTitleBar();
+        if( !m_rightButtons->buttons().isEmpty() )
+        { m_rightButtons->setPos(QPointF(newWidth - m_rightButtons->geometry().width(), 0)); }
+
+        invalidateTitleBarCache();
+
+        if( hideTitleBar() || oldWidth < 0 )
+        {
+            update();
+            return;
+        }
+
+        // repaint what moved: the right buttons, the caption, and the right corner of the title bar
+        QRect dirtyRect;
+        const QRect newRightButtons = m_rightButtons->geometry().toAlignedRect();
+        if( newRightButtons != oldRightButtons ) dirtyRect |= oldRightButtons | newRightButtons;
+
+        const QRect newCaption = captionTextRect();
+        if( newCaption != oldCaption ) dirtyRect |= oldCaption | newCaption;
+
+        if( newWidth != oldWidth )
+        {
+            const int left = qMin( oldWidth, newWidth ) - Metrics::Frame_FrameRadius;
+            dirtyRect |= QRect( left, 0, qMax( oldWidth, newWidth ) - left, buttonHeight() );
+        }
+
+        if( dirtyRect.isValid() ) update( dirtyRect );
+    }
+
+    //________________________________________________________________
+    QRect Decoration::captionTextRect() const
+    {
+        if( hideTitleBar() ) return QRect();
+        const CaptionLayout &layout( captionLayout() );
+        return QRectF( layout.position, layout.text.size() ).toAlignedRect();
+    }
+
+    //________________________________________________________________
+    void Decoration::reportLayoutStatistics()
+    {
+        if( !m_layoutStatistics.clock.isValid() )
+        {
+            m_layoutStatistics.clock.start();
+            return;
+        }
+
+        const qint64 elapsed = m_layoutStatistics.clock.elapsed();
+        if( elapsed < 1000 ) return;
+
+        // layouts only happen while the window is resized
+        if( m_layoutStatistics.layouts > 0 )
+        {
+            qCDebug(FLUENT_DECORATION) << "resizing" << client().data()->caption() << ":"
+                << m_layoutStatistics.layouts*1000.0/elapsed << "layouts/s,"
+                << m_layoutStatistics.repaints*1000.0/elapsed << "repaints/s";
+        }
 
+        m_layoutStatistics.layouts = 0;
+        m_layoutStatistics.repaints = 0;
+        m_layoutStatistics.clock.restart();
     }
 
     //________________________________________________________________
     void Decoration::paint(QPainter *painter, const QRect &repaintRegion)
     {
-        // TODO: optimize based on repaintRegion
-        auto s = settings();
+        // never paint with an outdated layout
+        if( m_layoutPending ) updateLayout();
 
-        if( !hideTitleBar() ) paintTitleBar(painter, repaintRegion);
+        ++m_layoutStatistics.repaints;
+        reportLayoutStatistics();
 
+        if( !hideTitleBar() ) paintTitleBar(painter, repaintRegion);
     }
 
+    //________________________________________________________________
+    const Decoration::TitleBarCacheStatistics& Decoration::titleBarCacheStatistics()
+    { return g_titleBarCacheStatistics; }
+
+    //________________________________________________________________
+    void Decoration::invalidateTitleBarCache()
+    { m_titleBarCache = QImage(); }
+
     //________________________________________________________________
     void Decoration::paintTitleBar(QPainter *painter, const QRect &repaintRegion)
     {
-        const auto c = client().data();
         const QRect titleRect(QPoint(0, 0), QSize(size().width(), buttonHeight()));
 
         if ( !titleRect.intersects(repaintRegion) ) return;
 
-        painter->save();
-        painter->setPen(Qt::NoPen);
+        // background and caption only change with the window state, and are cached
+        const qreal devicePixelRatio = painter->device()->devicePixelRatioF();
+        if( m_titleBarCache.isNull()
+            || m_titleBarCache.devicePixelRatio() != devicePixelRatio
+            || m_titleBarCache.size() != titleRect.size()*devicePixelRatio )
+        {
+
+            ++g_titleBarCacheStatistics.misses;
+            updateTitleBarCache( titleRect, devicePixelRatio );
+
+        } else ++g_titleBarCacheStatistics.hits;
+
+        const quint64 paints = g_titleBarCacheStatistics.hits + g_titleBarCacheStatistics.misses;
+        if( paints % s_titleBarCacheReportInterval == 0 )
+        {
+            qCDebug(FLUENT_DECORATION) << "title bar cache:" << g_titleBarCacheStatistics.hits << "hits,"
+                << g_titleBarCacheStatistics.misses << "misses, hit rate" << g_titleBarCacheStatistics.hitRate();
+        }
+
+        // only composite the damaged part
+        const QRect damagedRect = titleRect & repaintRegion;
+        const QRectF sourceRect( QPointF( damagedRect.topLeft() )*devicePixelRatio, QSizeF( damagedRect.size() )*devicePixelRatio );
+        painter->drawImage( QRectF( damagedRect ), m_titleBarCache, sourceRect );
+
+        // draw all buttons
+        m_leftButtons->paint(painter, repaintRegion);
+        m_rightButtons->paint(painter, repaintRegion);
+    }
+
+    //________________________________________________________________
+    void Decoration::updateTitleBarCache( const QRect &titleRect, qreal devicePixelRatio )
+    {
+        const auto c = client().data();
+
+        m_titleBarCache = QImage( titleRect.size()*devicePixelRatio, QImage::Format_ARGB32_Premultiplied );
+        m_titleBarCache.setDevicePixelRatio( devicePixelRatio );
+        m_titleBarCache.fill( Qt::transparent );
+
+        QPainter painter( &m_titleBarCache );
+        painter.setRenderHint( QPainter::Antialiasing );
+        painter.setPen(Qt::NoPen);
 
         QColor titleBarColor = this->titleBarColor();
         titleBarColor.setAlpha(titleBarAlpha());
 
-        painter->setBrush( titleBarColor );
+        painter.setBrush( titleBarColor );
 
         auto s = settings();
         if( isMaximized() || !s->isAlphaChannelSupported() )
         {
 
-            painter->drawRect(titleRect);
+            painter.drawRect(titleRect);
 
         } else if( c->isShaded() ) {
 
-            painter->drawRoundedRect(titleRect, Metrics::Frame_FrameRadius, Metrics::Frame_FrameRadius);
+            painter.drawRoundedRect(titleRect, Metrics::Frame_FrameRadius, Metrics::Frame_FrameRadius);
 
         } else {
 
-            painter->setClipRect(titleRect, Qt::IntersectClip);
+            painter.save();
+            painter.setClipRect(titleRect, Qt::IntersectClip);
 
             // the rect is made a little bit larger to be able to clip away the rounded corners at the bottom and sides
-            painter->drawRoundedRect(titleRect.adjusted(
+            painter.drawRoundedRect(titleRect.adjusted(
                 isLeftEdge() ? -Metrics::Frame_FrameRadius:0,
                 isTopEdge() ? -Metrics::Frame_FrameRadius:0,
                 isRightEdge() ? Metrics::Frame_FrameRadius:0,
                 Metrics::Frame_FrameRadius),
                 Metrics::Frame_FrameRadius, Metrics::Frame_FrameRadius);
 
-        }
+            painter.restore();
 
-        painter->restore();
+        }
 
         // draw caption
-        painter->setFont(s->font());
-        painter->setPen( fontColor() );
-        const auto cR = captionRect();
-        const QString caption = painter->fontMetrics().elidedText(c->caption(), Qt::ElideMiddle, cR.first.width());
-        painter->drawText(cR.first, cR.second | Qt::TextSingleLine, caption);
-
-        // draw all buttons
-        m_leftButtons->paint(painter, repaintRegion);
-        m_rightButtons->paint(painter, repaintRegion);
+        const CaptionLayout &layout( captionLayout() );
+        painter.setFont( layout.font );
+        painter.setPen( fontColor() );
+        painter.drawStaticText( layout.position, layout.text );
     }
 
     //________________________________________________________________
@@ -463,68 +606,220 @@ namespace Fluent
     //________________________________________________________________
     QPair<QRect,Qt::Alignment> Decoration::captionRect() const
     {
-        if( hideTitleBar() ) return qMakePair( QRect(), Qt::AlignCenter );
-        else {
-
-            auto c = client().data();
-            int leftOffset = m_leftButtons->buttons().isEmpty() ?
-                4.0*settings()->smallSpacing():
-                m_leftButtons->geometry().x() + m_leftButtons->geometry().width() + 4.0*settings()->smallSpacing();
+        const CaptionLayout &layout( captionLayout() );
+        return qMakePair( layout.rect, layout.alignment );
+    }
 
-            if (!m_leftButtons->buttons().isEmpty() 
-                && m_leftButtons->buttons().last().data()->type() == DecorationButtonType::Menu 
-                && m_internalSettings->titleAlignment() == InternalSettings::AlignLeft)
-            {
-                leftOffset -= 4.0 * settings()->smallSpacing();
-            }
-            
-            const int rightOffset = m_rightButtons->buttons().isEmpty() ?
-                4.0*settings()->smallSpacing() :
-                size().width() - m_rightButtons->geometry().x() + 4.0*settings()->smallSpacing();
+    //________________________________________________________________
+    const Decoration::CaptionLayout& Decoration::captionLayout() const
+    {
+        if( hideTitleBar() )
+        {
+            m_captionLayout = CaptionLayout();
+            return m_captionLayout;
+        }
 
-            const QRect maxRect( leftOffset, 0, size().width() - leftOffset - rightOffset, buttonHeight() );
+        auto c = client().data();
+        int leftOffset = m_leftButtons->buttons().isEmpty() ?
+            4.0*settings()->smallSpacing():
+            m_leftButtons->geometry().x() + m_leftButtons->geometry().width() + 4.0*settings()->smallSpacing();
 
-            switch( m_internalSettings->titleAlignment() )
-            {
-                case InternalSettings::AlignLeft:
-                return qMakePair( maxRect, Qt::AlignVCenter|Qt::AlignLeft );
+        if (!m_leftButtons->buttons().isEmpty()
+            && m_leftButtons->buttons().last().data()->type() == DecorationButtonType::Menu
+            && m_internalSettings->titleAlignment() == InternalSettings::AlignLeft)
+        {
+            leftOffset -= 4.0 * settings()->smallSpacing();
+        }
 
-                case InternalSettings::AlignRight:
-                return qMakePair( maxRect, Qt::AlignVCenter|Qt::AlignRight );
+        const int rightOffset = m_rightButtons->buttons().isEmpty() ?
+            4.0*settings()->smallSpacing() :
+            size().width() - m_rightButtons->geometry().x() + 4.0*settings()->smallSpacing();
 
-                case InternalSettings::AlignCenter:
-                return qMakePair( maxRect, Qt::AlignCenter );
+        const QRect maxRect( leftOffset, 0, size().width() - leftOffset - rightOffset, buttonHeight() );
 
-                default:
-                case InternalSettings::AlignCenterFullWidth:
-                {
+        // the caption is only measured again when the caption or the font change
+        const QString caption = c->caption();
+        const QFont font = settings()->font();
+        CaptionLayout &layout( m_captionLayout );
+        if( !( layout.isValid && layout.caption == caption && layout.font == font ) )
+        {
+            layout = CaptionLayout();
+            layout.isValid = true;
+            layout.caption = caption;
+            layout.font = font;
+
+            const QFontMetricsF fontMetrics( font );
+            layout.captionWidth = fontMetrics.boundingRect( caption ).toRect().width();
+            #if QT_VERSION >= QT_VERSION_CHECK(5, 11, 0)
+            layout.captionAdvance = fontMetrics.horizontalAdvance( caption );
+            #else
+            layout.captionAdvance = fontMetrics.width( caption );
+            #endif
+            layout.text.setTextFormat( Qt::PlainText );
+        }
 
-                    // full caption rect
-                    const QRect fullRect = QRect( 0, 0, size().width(), buttonHeight() );
-                    QRect boundingRect( settings()->fontMetrics().boundingRect( c->caption()).toRect() );
+        // the placement follows every resize, it does not shape any text
+        switch( m_internalSettings->titleAlignment() )
+        {
+            case InternalSettings::AlignLeft:
+            layout.rect = maxRect;
+            layout.alignment = Qt::AlignVCenter|Qt::AlignLeft;
+            break;
+
+            case InternalSettings::AlignRight:
+            layout.rect = maxRect;
+            layout.alignment = Qt::AlignVCenter|Qt::AlignRight;
+            break;
+
+            case InternalSettings::AlignCenter:
+            layout.rect = maxRect;
+            layout.alignment = Qt::AlignCenter;
+            break;
+
+            default:
+            case InternalSettings::AlignCenterFullWidth:
+            {
 
-                    // text bounding rect
-                    boundingRect.setTop( 0 );
-                    boundingRect.setHeight( buttonHeight() );
-                    boundingRect.moveLeft( ( size().width() - boundingRect.width() )/2 );
+                // full caption rect
+                const QRect fullRect = QRect( 0, 0, size().width(), buttonHeight() );
 
-                    if( boundingRect.left() < leftOffset ) return qMakePair( maxRect, Qt::AlignVCenter|Qt::AlignLeft );
-                    else if( boundingRect.right() > size().width() - rightOffset ) return qMakePair( maxRect, Qt::AlignVCenter|Qt::AlignRight );
-                    else return qMakePair(fullRect, Qt::AlignCenter);
+                // text bounding rect
+                QRect boundingRect( 0, 0, layout.captionWidth, buttonHeight() );
+                boundingRect.moveLeft( ( size().width() - boundingRect.width() )/2 );
 
+                if( boundingRect.left() < leftOffset )
+                {
+                    layout.rect = maxRect;
+                    layout.alignment = Qt::AlignVCenter|Qt::AlignLeft;
+                } else if( boundingRect.right() > size().width() - rightOffset ) {
+                    layout.rect = maxRect;
+                    layout.alignment = Qt::AlignVCenter|Qt::AlignRight;
+                } else {
+                    layout.rect = fullRect;
+                    layout.alignment = Qt::AlignCenter;
                 }
 
             }
 
         }
 
+        // the whole caption is kept as long as it fits, otherwise it is elided
+        // again only when the width changes, and shaped again only when the
+        // elided text changes, as a single line of plain text
+        const int width( layout.rect.width() );
+        const int elidedWidth( layout.captionAdvance <= width ? 0 : width );
+        if( elidedWidth != layout.elidedWidth )
+        {
+            layout.elidedWidth = elidedWidth;
+
+            QString elidedCaption = elidedWidth ? QFontMetricsF( font ).elidedText( caption, Qt::ElideMiddle, width ) : caption;
+            elidedCaption.replace( QLatin1Char( '\n' ), QLatin1Char( ' ' ) );
+            if( elidedCaption != layout.text.text() )
+            {
+                layout.text.setText( elidedCaption );
+                layout.text.prepare( QTransform(), font );
+            }
+        }
+
+        // position of the text in the caption rect
+        const QSizeF textSize( layout.text.size() );
+        qreal x = layout.rect.left();
+        if( layout.alignment & Qt::AlignRight ) x = layout.rect.left() + layout.rect.width() - textSize.width();
+        else if( layout.alignment & Qt::AlignHCenter ) x = layout.rect.left() + ( layout.rect.width() - textSize.width() )/2;
+        const qreal y = layout.rect.top() + ( layout.rect.height() - textSize.height() )/2;
+        layout.position = QPointF( qRound( x ), qRound( y ) );
+
+        return layout;
     }
 
+    //________________________________________________________________
+    // Render the shadow. KDecoration2::DecorationShadow has no device pixel
+    // ratio: kwin reads the padding, the inner rect and the texture in
+    // logical pixels, so the shadow is rendered at a device pixel ratio of 1.
+    static QSharedPointer<KDecoration2::DecorationShadow> renderShadow(const CompositeShadowParams &params)
+    {
+        auto withOpacity = [](const QColor &color, qreal opacity) -> QColor {
+            QColor c(color);
+            c.setAlphaF(opacity);
+            return c;
+        };
+
+        const QSize boxSize = BoxShadowRenderer::calculateMinimumBoxSize(params.shadow1.radius)
+            .expandedTo(BoxShadowRenderer::calculateMinimumBoxSize(params.shadow2.radius));
+
+        BoxShadowRenderer shadowRenderer;
+        shadowRenderer.setBorderRadius(Metrics::Frame_FrameRadius + 0.5);
+        shadowRenderer.setBoxSize(boxSize);
+        shadowRenderer.setDevicePixelRatio(1.0);
+
+        const qreal strength = static_cast<qreal>(g_shadowStrength) / 255.0;
+        shadowRenderer.addShadow(params.shadow1.offset, params.shadow1.radius,
+            withOpacity(g_shadowColor, params.shadow1.opacity * strength));
+        shadowRenderer.addShadow(params.shadow2.offset, params.shadow2.radius,
+            withOpacity(g_shadowColor, params.shadow2.opacity * strength));
+
+        const QSize textureSize = shadowRenderer.textureSize();
+        const QColor outlineColor = withOpacity(g_shadowColor, 0.2 * strength);
+
+        auto shadow = QSharedPointer<KDecoration2::DecorationShadow>::create();
+
+        QImage shadowTexture;
+        if (textureSize.width() * textureSize.height() < s_asyncShadowArea
+                || ShadowCache::self()->containsTexture(shadowRenderer)) {
+            shadowTexture = ShadowCache::self()->texture(shadowRenderer);
+        } else {
+            // Show a low resolution shadow, scaled up, while the real one is
+            // rendered in the background. Blurry textures survive the scaling
+            // well, as long as rounding the scaled down blur radii does not
+            // change the blur. The smallest radius is therefore kept at
+            // s_placeholderBlurRadius pixels at least, which also bounds
+            // the work done here on the GUI thread to a fraction of it.
+            const int minimumRadius = qMin(params.shadow1.radius, params.shadow2.radius);
+            const qreal placeholderScale = qBound(0.25, qreal(s_placeholderBlurRadius) / qMax(1, minimumRadius), 1.0);
+            BoxShadowRenderer placeholderRenderer(shadowRenderer);
+            placeholderRenderer.setDevicePixelRatio(placeholderScale);
+            shadowTexture = placeholderRenderer.render()
+                .scaled(textureSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+            shadowTexture.setDevicePixelRatio(1.0);
+
+            const int generation = g_shadowGeneration;
+            const QWeakPointer<KDecoration2::DecorationShadow> weakShadow = shadow;
+
+            auto watcher = new QFutureWatcher<QImage>();
+            QObject::connect(watcher, &QFutureWatcher<QImage>::finished, watcher,
+                [watcher, shadowRenderer, generation, weakShadow, boxSize, params, outlineColor]() {
+                    watcher->deleteLater();
+
+                    // this only stores the texture in memory, the shadow cache
+                    // writes its disk cache later on a thread of its own
+                    const QImage texture = watcher->result();
+                    ShadowCache::self()->insertTexture(shadowRenderer, texture);
+
+                    const auto shadow = weakShadow.toStrongRef();
+                    if (generation != g_shadowGeneration || !shadow) {
+                        return;
+                    }
+
+                    QImage finalTexture = texture;
+                    maskShadowTexture(finalTexture, boxSize, params, outlineColor);
+                    shadow->setShadow(finalTexture);
+                });
+            watcher->setFuture(shadowRenderer.renderAsync());
+        }
+
+        const QMargins padding = maskShadowTexture(shadowTexture, boxSize, params, outlineColor);
+        const QRect outerRect = shadowTexture.rect();
+
+        shadow->setPadding(padding);
+        shadow->setInnerShadowRect(QRect(outerRect.center(), QSize(1, 1)));
+        shadow->setShadow(shadowTexture);
+        return shadow;
+    }
     //________________________________________________________________
     void Decoration::createShadow()
     {
         if (!g_sShadow
-                ||g_shadowSizeEnum != m_internalSettings->shadowSize()
+                || g_shadowSizeEnum != m_internalSettings->shadowSize()
                 || g_shadowStrength != m_internalSettings->shadowStrength()
                 || g_shadowColor != m_internalSettings->shadowColor())
         {
@@ -532,78 +827,22 @@ namespace Fluent
             g_shadowStrength = m_internalSettings->shadowStrength();
             g_shadowColor = m_internalSettings->shadowColor();
 
-            const CompositeShadowParams params = lookupShadowParams(g_shadowSizeEnum);
+            // drops the shadow that may still be rendering
+            ++g_shadowGeneration;
+
+            const CompositeShadowParams params = lookupShadowParams(s_decorationShadowParams, g_shadowSizeEnum);
             if (params.isNone()) {
                 g_sShadow.clear();
                 setShadow(g_sShadow);
                 return;
             }
 
-            auto withOpacity = [](const QColor &color, qreal opacity) -> QColor {
-                QColor c(color);
-                c.setAlphaF(opacity);
-                return c;
-            };
-
-            const QSize boxSize = BoxShadowRenderer::calculateMinimumBoxSize(params.shadow1.radius)
-                .expandedTo(BoxShadowRenderer::calculateMinimumBoxSize(params.shadow2.radius));
-
-            BoxShadowRenderer shadowRenderer;
-            shadowRenderer.setBorderRadius(Metrics::Frame_FrameRadius + 0.5);
-            shadowRenderer.setBoxSize(boxSize);
-            shadowRenderer.setDevicePixelRatio(1.0); // TODO: Create HiDPI shadows?
-
-            const qreal strength = static_cast<qreal>(g_shadowStrength) / 255.0;
-            shadowRenderer.addShadow(params.shadow1.offset, params.shadow1.radius,
-                withOpacity(g_shadowColor, params.shadow1.opacity * strength));
-            shadowRenderer.addShadow(params.shadow2.offset, params.shadow2.radius,
-                withOpacity(g_shadowColor, params.shadow2.opacity * strength));
-
-            QImage shadowTexture = shadowRenderer.render();
-
-            QPainter painter(&shadowTexture);
-            painter.setRenderHint(QPainter::Antialiasing);
-
-            const QRect outerRect = shadowTexture.rect();
-
-            QRect boxRect(QPoint(0, 0), boxSize);
-            boxRect.moveCenter(outerRect.center());
-
-            // Mask out inner rect.
-            const QMargins padding = QMargins(
-                boxRect.left() - outerRect.left() - Metrics::Shadow_Overlap - params.offset.x(),
-                boxRect.top() - outerRect.top() - Metrics::Shadow_Overlap - params.offset.y(),
-                outerRect.right() - boxRect.right() - Metrics::Shadow_Overlap + params.offset.x(),
-                outerRect.bottom() - boxRect.bottom() - Metrics::Shadow_Overlap + params.offset.y());
-            const QRect innerRect = outerRect - padding;
-
-            painter.setPen(Qt::NoPen);
-            painter.setBrush(Qt::black);
-            painter.setCompositionMode(QPainter::CompositionMode_DestinationOut);
-            painter.drawRoundedRect(
-                innerRect,
-                Metrics::Frame_FrameRadius + 0.5,
-                Metrics::Frame_FrameRadius + 0.5);
-
-            // Draw outline.
-            painter.setPen(withOpacity(g_shadowColor, 0.2 * strength));
-            painter.setBrush(Qt::NoBrush);
-            painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
-            painter.drawRoundedRect(
-                innerRect,
-                Metrics::Frame_FrameRadius - 0.5,
-                Metrics::Frame_FrameRadius - 0.5);
-
-            painter.end();
-
-            g_sShadow = QSharedPointer<KDecoration2::DecorationShadow>::create();
-            g_sShadow->setPadding(padding);
-            g_sShadow->setInnerShadowRect(QRect(outerRect.center(), QSize(1, 1)));
-            g_sShadow->setShadow(shadowTexture);
+            g_sShadow = renderShadow(params);
         }
 
         setShadow(g_sShadow);
     }
+
 } // namespace
 
 
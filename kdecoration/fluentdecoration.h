@@ -23,14 +23,19 @@
  */
 
 #include "fluent.h"
+#include "fluentanimationdriver.h"
 #include "fluentsettings.h"
+#include "fluentsettingsprovider.h"
 
 #include <KDecoration2/Decoration>
 #include <KDecoration2/DecoratedClient>
 #include <KDecoration2/DecorationSettings>
 
+#include <QElapsedTimer>
+#include <QImage>
 #include <QPalette>
-#include <QPropertyAnimation>
+#include <QStaticText>
+#include <QTimer>
 #include <QVariant>
 
 namespace KDecoration2
@@ -90,6 +95,19 @@ namespace Fluent
         QColor fontColor() const;
         //@}
 
+        //* title bar cache statistics, shared by all decorations
+        struct TitleBarCacheStatistics
+        {
+            quint64 hits = 0;
+            quint64 misses = 0;
+
+            //* fraction of the title bar paints served from the cache
+            qreal hitRate() const
+            { return hits + misses ? qreal( hits )/( hits + misses ) : 0; }
+        };
+
+        static const TitleBarCacheStatistics& titleBarCacheStatistics();
+
         //*@name maximization modes
         //@{
         inline bool isMaximized() const;
@@ -112,16 +130,63 @@ namespace Fluent
         void recalculateBorders();
         void updateButtonsGeometry();
         void updateButtonsGeometryDelayed();
+        void scheduleLayout();
+        void updateLayout();
         void updateTitleBar();
         void updateAnimationState();
+        void invalidateTitleBarCache();
 
         private:
 
+        //* caption, elided and shaped for the title bar
+        struct CaptionLayout
+        {
+            //*@name key of the measured caption
+            //@{
+            bool isValid = false;
+            QString caption;
+            QFont font;
+            //@}
+
+            //* width of the bounding rect of the whole caption
+            int captionWidth = 0;
+
+            //* advance of the whole caption, it fits in any wider rect
+            qreal captionAdvance = 0;
+
+            //* width the text was elided to, 0 if it is the whole caption, -1 before the text is set
+            int elidedWidth = -1;
+
+            //* rect in which the caption is drawn
+            QRect rect;
+            Qt::Alignment alignment = Qt::AlignCenter;
+
+            //* elided caption, and its position
+            QStaticText text;
+            QPointF position;
+        };
+
         //* return the rect in which caption will be drawn
         QPair<QRect,Qt::Alignment> captionRect() const;
 
+        //* return the caption layout. The caption is measured again when it or the font change, and elided again when the width changes while it does not fit
+        const CaptionLayout& captionLayout() const;
+
         void createButtons();
+
+        //* position the buttons, without repainting
+        void layoutButtons();
+
+        //* rect covered by the caption text
+        QRect captionTextRect() const;
+
+        //* log layouts and repaints per second, while resizing
+        void reportLayoutStatistics();
+
         void paintTitleBar(QPainter *painter, const QRect &repaintRegion);
+
+        //* paint title bar background and caption to the cache
+        void updateTitleBarCache( const QRect &titleRect, qreal devicePixelRatio );
         void createShadow();
 
         //*@name color customization
@@ -130,16 +195,47 @@ namespace Fluent
         inline int titleBarAlpha() const;
         //@}
 
+        //* settings snapshot in use, never modified
         InternalSettingsPtr m_internalSettings;
+
+        //* what the settings provider knows about the window
+        WindowSettingsCache m_settingsCache;
+
         KDecoration2::DecorationButtonGroup *m_leftButtons = nullptr;
         KDecoration2::DecorationButtonGroup *m_rightButtons = nullptr;
 
         //* active state change animation
-        QPropertyAnimation *m_animation;
+        FadeAnimation m_animation;
 
         //* active state change opacity
         qreal m_opacity = 0;
 
+        //* title bar background and caption, without the buttons
+        QImage m_titleBarCache;
+
+        //* caption layout cache
+        mutable CaptionLayout m_captionLayout;
+
+        //*@name coalesced layout
+        //@{
+        QTimer m_layoutTimer;
+        QElapsedTimer m_lastLayout;
+        bool m_layoutPending = false;
+
+        //* width of the last layout
+        int m_layoutWidth = -1;
+        //@}
+
+        //* layouts and repaints since the clock started
+        struct LayoutStatistics
+        {
+            QElapsedTimer clock;
+            int layouts = 0;
+            int repaints = 0;
+        };
+
+        LayoutStatistics m_layoutStatistics;
+
     };
 
     bool Decoration::isMaximized() const
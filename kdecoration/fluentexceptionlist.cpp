@@ -30,42 +30,75 @@
 namespace Fluent
 {
 
+    //______________________________________________________________
+    void ExceptionDelta::apply( InternalSettings* settings ) const
+    {
+        settings->setEnabled( enabled );
+        settings->setExceptionType( exceptionType );
+        settings->setExceptionPattern( exceptionPattern );
+        settings->setMask( mask );
+
+        // propagate all features found in mask to the output configuration
+        settings->setHideTitleBar( hideTitleBar );
+        settings->setOpaqueTitleBar( opaqueTitleBar );
+        settings->setOpacityOverride( opacityOverride );
+    }
+
     //______________________________________________________________
     void ExceptionList::readConfig( KSharedConfig::Ptr config )
     {
 
         _exceptions.clear();
 
-        QString groupName;
-        for( int index = 0; config->hasGroup( groupName = exceptionGroupName( index ) ); ++index )
+        // only the exception fields are edited and written back, the others keep their default values
+        foreach( const ExceptionDelta& delta, readDeltas( config ) )
         {
+            InternalSettingsPtr configuration( new InternalSettings() );
+            delta.apply( configuration.data() );
+            _exceptions.append( configuration );
+        }
 
-            // create exception
-            InternalSettings exception;
+    }
 
-            // reset group
-            readConfig( &exception, config.data(), groupName );
+    //______________________________________________________________
+    QVector<ExceptionDelta> ExceptionList::readDeltas( KSharedConfig::Ptr config )
+    {
 
-            // create new configuration
-            InternalSettingsPtr configuration( new InternalSettings() );
-            configuration.data()->load();
+        QVector<ExceptionDelta> deltas;
 
-            // apply changes from exception
-            configuration->setEnabled( exception.enabled() );
-            configuration->setExceptionType( exception.exceptionType() );
-            configuration->setExceptionPattern( exception.exceptionPattern() );
-            configuration->setMask( exception.mask() );
+        // a single skeleton reads all exceptions, its exception items are pointed at each group in turn
+        InternalSettings exception;
+        QList<KConfigSkeletonItem*> items;
+        foreach( auto key, exceptionKeys() )
+        {
+            if( KConfigSkeletonItem* item = exception.findItem( key ) )
+            { items.append( item ); }
+        }
 
-            // propagate all features found in mask to the output configuration
-            configuration->setHideTitleBar( exception.hideTitleBar() );
-            configuration->setOpaqueTitleBar( exception.opaqueTitleBar() );
-            configuration->setOpacityOverride( exception.opacityOverride() );
+        QString groupName;
+        for( int index = 0; config->hasGroup( groupName = exceptionGroupName( index ) ); ++index )
+        {
 
-            // append to exceptions
-            _exceptions.append( configuration );
+            foreach( KConfigSkeletonItem* item, items )
+            {
+                item->setGroup( groupName );
+                item->readConfig( config.data() );
+            }
+
+            ExceptionDelta delta;
+            delta.enabled = exception.enabled();
+            delta.exceptionType = exception.exceptionType();
+            delta.exceptionPattern = exception.exceptionPattern();
+            delta.mask = exception.mask();
+            delta.hideTitleBar = exception.hideTitleBar();
+            delta.opaqueTitleBar = exception.opaqueTitleBar();
+            delta.opacityOverride = exception.opacityOverride();
+            deltas.append( delta );
 
         }
 
+        return deltas;
+
     }
 
     //______________________________________________________________
@@ -93,15 +126,16 @@ namespace Fluent
     QString ExceptionList::exceptionGroupName( int index )
     { return QString( "Windeco Exception %1" ).arg( index ); }
 
+    //_______________________________________________________________________
+    QStringList ExceptionList::exceptionKeys()
+    { return { "Enabled", "ExceptionPattern", "ExceptionType", "HideTitleBar", "OpaqueTitleBar", "OpacityOverride", "Mask" }; }
+
     //______________________________________________________________
     void ExceptionList::writeConfig( KCoreConfigSkeleton* skeleton, KConfig* config, const QString& groupName )
     {
 
-        // list of items to be written
-        QStringList keys = { "Enabled", "ExceptionPattern", "ExceptionType", "HideTitleBar", "OpaqueTitleBar", "OpacityOverride", "Mask" };
-
         // write all items
-        foreach( auto key, keys )
+        foreach( auto key, exceptionKeys() )
         {
             KConfigSkeletonItem* item( skeleton->findItem( key ) );
             if( !item ) continue;
@@ -114,16 +148,4 @@ namespace Fluent
 
     }
 
-    //______________________________________________________________
-    void ExceptionList::readConfig( KCoreConfigSkeleton* skeleton, KConfig* config, const QString& groupName )
-    {
-
-        foreach( KConfigSkeletonItem* item, skeleton->items() )
-        {
-            if( !groupName.isEmpty() ) item->setGroup( groupName );
-            item->readConfig( config );
-        }
-
-    }
-
 }
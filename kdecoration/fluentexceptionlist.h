@@ -32,9 +32,26 @@
 
 #include <KSharedConfig>
 
+#include <QVector>
+
 namespace Fluent
 {
 
+    //! fields an exception overrides, the other ones come from the default settings
+    struct ExceptionDelta
+    {
+        bool enabled = true;
+        int exceptionType = InternalSettings::ExceptionWindowClassName;
+        QString exceptionPattern;
+        int mask = 0;
+        bool hideTitleBar = false;
+        bool opaqueTitleBar = false;
+        int opacityOverride = -1;
+
+        //! overlay on given settings
+        void apply( InternalSettings* ) const;
+    };
+
     //! fluent exceptions list
     class ExceptionList
     {
@@ -53,6 +70,9 @@ namespace Fluent
         //! read from KConfig
         void readConfig( KSharedConfig::Ptr );
 
+        //! read the fields of all exceptions, in one pass and without reloading the configuration
+        static QVector<ExceptionDelta> readDeltas( KSharedConfig::Ptr );
+
         //! write to kconfig
         void writeConfig( KSharedConfig::Ptr );
 
@@ -61,8 +81,8 @@ namespace Fluent
         //! generate exception group name for given exception index
         static QString exceptionGroupName( int index );
 
-        //! read configuration
-        static void readConfig( KCoreConfigSkeleton*, KConfig*, const QString& );
+        //! keys of the fields stored for an exception
+        static QStringList exceptionKeys();
 
         //! write configuration
         static void writeConfig( KCoreConfigSkeleton*, KConfig*, const QString& );
@@ -20,110 +20,155 @@
 
 #include "fluentsettingsprovider.h"
 
+#include "fluentbuttonglyphatlas.h"
+#include "fluentdecoration.h"
 #include "fluentexceptionlist.h"
 
 #include <KWindowInfo>
 
+#include <QCoreApplication>
 #include <QTextStream>
 
 namespace Fluent
 {
 
-    SettingsProvider *SettingsProvider::s_self = nullptr;
-
     //__________________________________________________________________
     SettingsProvider::SettingsProvider():
         m_config( KSharedConfig::openConfig( QStringLiteral("fluentrc") ) )
-    { reconfigure(); }
-
-    //__________________________________________________________________
-    SettingsProvider::~SettingsProvider()
-    { s_self = nullptr; }
+    {
+        // reconfiguration is triggered from the gui thread
+        if( QCoreApplication::instance() ) moveToThread( QCoreApplication::instance()->thread() );
+        reconfigure();
+    }
 
     //__________________________________________________________________
     SettingsProvider *SettingsProvider::self()
     {
-        // TODO: this is not thread safe!
-        if (!s_self)
-        { s_self = new SettingsProvider(); }
-
+        // initialization of function statics is thread safe
+        static SettingsProvider *s_self = new SettingsProvider();
         return s_self;
     }
 
     //__________________________________________________________________
     void SettingsProvider::reconfigure()
     {
-        if( !m_defaultSettings )
+
+        // the new settings are read aside, decorations keep using the current ones meanwhile
+        auto snapshot = std::make_shared<Snapshot>();
+        const SnapshotPtr current = this->snapshot();
+        snapshot->generation = current ? current->generation + 1 : 1;
+
+        snapshot->defaultSettings = InternalSettingsPtr(new InternalSettings());
+        snapshot->defaultSettings->setCurrentGroup( QStringLiteral("Windeco") );
+        snapshot->defaultSettings->load();
+
+        // exceptions only keep the fields they override, read in one pass
+        foreach( const ExceptionDelta& delta, ExceptionList::readDeltas( m_config ) )
         {
-            m_defaultSettings = InternalSettingsPtr(new InternalSettings());
-            m_defaultSettings->setCurrentGroup( QStringLiteral("Windeco") );
+
+            // compile the patterns once, disabled exceptions and exceptions with an empty pattern never match
+            if( !delta.enabled ) continue;
+            if( delta.exceptionPattern.isEmpty() ) continue;
+
+            Exception exception;
+            exception.delta = delta;
+            exception.pattern = QRegularExpression( delta.exceptionPattern );
+            exception.pattern.optimize();
+            exception.matchesTitle = delta.exceptionType == InternalSettings::ExceptionWindowTitle;
+
+            // the settings are created before publication, so the snapshot is never written afterwards
+            exception.settings = exceptionSettings( snapshot->defaultSettings, delta );
+            snapshot->exceptions.append( exception );
+
         }
 
-        m_defaultSettings->load();
+        std::atomic_store( &m_snapshot, SnapshotPtr( std::move( snapshot ) ) );
 
-        ExceptionList exceptions;
-        exceptions.readConfig( m_config );
-        m_exceptions = exceptions.get();
+        // glyphs are rasterized again with the new settings
+        ButtonGlyphAtlas::self()->clear();
 
     }
 
     //__________________________________________________________________
-    InternalSettingsPtr SettingsProvider::internalSettings( Decoration *decoration ) const
+    InternalSettingsPtr SettingsProvider::internalSettings( Decoration *decoration, WindowSettingsCache &cache ) const
     {
 
-        QString windowTitle;
-        QString className;
+        const SnapshotPtr snapshot = this->snapshot();
 
         // get the client
         auto client = decoration->client().data();
 
-        foreach( auto internalSettings, m_exceptions )
-        {
+        // the settings only change with the caption if a title exception was tried
+        if( cache.settings && cache.generation == snapshot->generation
+            && !( cache.dependsOnCaption && cache.caption != client->caption() ) )
+        { return cache.settings; }
 
-            // discard disabled exceptions
-            if( !internalSettings->enabled() ) continue;
+        cache.settings = snapshot->defaultSettings;
+        cache.generation = snapshot->generation;
+        cache.dependsOnCaption = false;
 
-            // discard exceptions with empty exception pattern
-            if( internalSettings->exceptionPattern().isEmpty() ) continue;
+        foreach( const Exception &exception, snapshot->exceptions )
+        {
 
             /*
             decide which value is to be compared
             to the regular expression, based on exception type
             */
             QString value;
-            switch( internalSettings->exceptionType() )
+            if( exception.matchesTitle )
             {
-                case InternalSettings::ExceptionWindowTitle:
+
+                if( !cache.dependsOnCaption )
                 {
-                    value = windowTitle.isEmpty() ? (windowTitle = client->caption()):windowTitle;
-                    break;
+                    cache.caption = client->caption();
+                    cache.dependsOnCaption = true;
                 }
 
-                default:
-                case InternalSettings::ExceptionWindowClassName:
+                value = cache.caption;
+
+            } else {
+
+                if( !cache.hasClassName )
                 {
-                    if( className.isEmpty() )
-                    {
-                        // retrieve class name
-                        KWindowInfo info( client->windowId(), nullptr, NET::WM2WindowClass );
-                        QString window_className( QString::fromUtf8(info.windowClassName()) );
-                        QString window_class( QString::fromUtf8(info.windowClassClass()) );
-                        className = window_className + QStringLiteral(" ") + window_class;
-                    }
-
-                    value = className;
-                    break;
+                    // retrieve class name
+                    KWindowInfo info( client->windowId(), nullptr, NET::WM2WindowClass );
+                    QString window_className( QString::fromUtf8(info.windowClassName()) );
+                    QString window_class( QString::fromUtf8(info.windowClassClass()) );
+                    cache.className = window_className + QStringLiteral(" ") + window_class;
+                    cache.hasClassName = true;
                 }
 
+                value = cache.className;
+
             }
 
             // check matching
-            if( QRegExp( internalSettings->exceptionPattern() ).indexIn( value ) >= 0 )
-            { return internalSettings; }
+            if( exception.pattern.match( value ).hasMatch() )
+            {
+                cache.settings = exception.settings;
+                break;
+            }
+
+        }
 
+        return cache.settings;
+
+    }
+
+    //__________________________________________________________________
+    InternalSettingsPtr SettingsProvider::exceptionSettings( const InternalSettingsPtr &defaultSettings, const ExceptionDelta &delta )
+    {
+
+        // copy the default settings from memory, and apply the delta
+        InternalSettingsPtr configuration( new InternalSettings() );
+        foreach( KConfigSkeletonItem* item, defaultSettings->items() )
+        {
+            if( KConfigSkeletonItem* target = configuration->findItem( item->name() ) )
+            { target->setProperty( item->property() ); }
         }
 
-        return m_defaultSettings;
+        delta.apply( configuration.data() );
+        return configuration;
 
     }
 
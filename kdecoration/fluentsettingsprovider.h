@@ -20,17 +20,39 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include "fluentdecoration.h"
+#include "fluentexceptionlist.h"
 #include "fluentsettings.h"
 #include "fluent.h"
 
 #include <KSharedConfig>
 
 #include <QObject>
+#include <QRegularExpression>
+#include <QVector>
+
+#include <memory>
 
 namespace Fluent
 {
 
+    class Decoration;
+
+    //* what is known about a window, owned by its decoration
+    struct WindowSettingsCache
+    {
+        //* window class, retrieved once
+        QString className;
+        bool hasClassName = false;
+
+        //* settings last found for the window, and the generation of the snapshot they were found in
+        InternalSettingsPtr settings;
+        quint64 generation = 0;
+
+        //* caption the settings were found with, if a title exception was tried
+        QString caption;
+        bool dependsOnCaption = false;
+    };
+
     class SettingsProvider: public QObject
     {
 
@@ -39,17 +61,48 @@ namespace Fluent
         public:
 
         //* destructor
-        ~SettingsProvider();
+        ~SettingsProvider() = default;
 
         //* singleton
         static SettingsProvider *self();
 
-        //* internal settings for given decoration
-        InternalSettingsPtr internalSettings(Decoration *) const;
+        //* exception, with its pattern compiled once
+        struct Exception
+        {
+            ExceptionDelta delta;
+            QRegularExpression pattern;
+            bool matchesTitle = false;
+
+            //* default settings with the delta applied
+            InternalSettingsPtr settings;
+        };
+
+        //* settings read at once, complete and never modified after they are published
+        struct Snapshot
+        {
+            //* increased with every reconfiguration
+            quint64 generation = 0;
+
+            //* default configuration
+            InternalSettingsPtr defaultSettings;
+
+            //* enabled exceptions, in order
+            QVector<Exception> exceptions;
+        };
+
+        using SnapshotPtr = std::shared_ptr<const Snapshot>;
+
+        //* current settings, can be called from any thread
+        SnapshotPtr snapshot() const
+        { return std::atomic_load( &m_snapshot ); }
+
+        //* internal settings for given decoration, from the gui thread only
+        //* it reads the client caption, queries the window class from X, and updates the cache
+        InternalSettingsPtr internalSettings( Decoration*, WindowSettingsCache& ) const;
 
         public Q_SLOTS:
 
-        //* reconfigure
+        //* read the settings again and publish them
         void reconfigure();
 
         private:
@@ -57,17 +110,14 @@ namespace Fluent
         //* constructor
         SettingsProvider();
 
-        //* default configuration
-        InternalSettingsPtr m_defaultSettings;
-
-        //* exceptions
-        InternalSettingsList m_exceptions;
+        //* default settings with the delta of an exception applied
+        static InternalSettingsPtr exceptionSettings( const InternalSettingsPtr&, const ExceptionDelta& );
 
         //* config object
         KSharedConfigPtr m_config;
 
-        //* singleton
-        static SettingsProvider *s_self;
+        //* published settings, only accessed atomically
+        SnapshotPtr m_snapshot;
 
     };
 
@@ -52,6 +52,10 @@ namespace Fluent
         static void setSteps( int value )
         { _steps = value; }
 
+        //* steps
+        static int steps()
+        { return _steps; }
+
         //* enability
         virtual bool enabled() const
         { return _enabled; }
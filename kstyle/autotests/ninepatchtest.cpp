@@ -0,0 +1,182 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Large frames painted from nine-patches, compared with the same frames
+ * painted directly, see Helper::renderNinePatch().
+ */
+
+#include "fluenthelper.h"
+
+#include <KSharedConfig>
+
+#include <QPainter>
+#include <QStandardPaths>
+#include <QTest>
+
+using namespace Fluent;
+
+class NinePatchTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void testFrames_data();
+    void testFrames();
+
+private:
+    QScopedPointer<Helper> m_helper;
+};
+
+enum FramePrimitive {
+    Frame,
+    MenuFrame,
+    TabWidgetFrame
+};
+
+Q_DECLARE_METATYPE(FramePrimitive)
+
+// Paint a frame over the background, from a nine-patch or directly.
+static QImage paintFrame(Helper *helper, FramePrimitive primitive, qreal dpr, const QColor &background,
+    const QColor &color, const QColor &outline, bool ninePatch)
+{
+    const QSize size(64, 48);
+    QImage image(size * dpr, QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(dpr);
+    image.fill(background);
+
+    helper->setNinePatchEnabled(ninePatch);
+
+    QPainter painter(&image);
+    const QRect rect(QPoint(4, 4), size - QSize(8, 8));
+    switch (primitive) {
+    case Frame:
+        helper->renderFrame(&painter, rect, color, outline);
+        break;
+    case MenuFrame:
+        helper->renderMenuFrame(&painter, rect, color, outline, true);
+        break;
+    case TabWidgetFrame:
+        helper->renderTabWidgetFrame(&painter, rect, color, outline, CornersTop | CornerBottomLeft);
+        break;
+    }
+    painter.end();
+
+    return image;
+}
+
+// The largest difference of any channel of any pixel.
+static int maxDifference(const QImage &first, const QImage &second)
+{
+    int difference = 0;
+    for (int y = 0; y < first.height(); ++y) {
+        const QRgb *firstLine = reinterpret_cast<const QRgb *>(first.constScanLine(y));
+        const QRgb *secondLine = reinterpret_cast<const QRgb *>(second.constScanLine(y));
+        for (int x = 0; x < first.width(); ++x) {
+            difference = qMax(difference, qAbs(qRed(firstLine[x]) - qRed(secondLine[x])));
+            difference = qMax(difference, qAbs(qGreen(firstLine[x]) - qGreen(secondLine[x])));
+            difference = qMax(difference, qAbs(qBlue(firstLine[x]) - qBlue(secondLine[x])));
+            difference = qMax(difference, qAbs(qAlpha(firstLine[x]) - qAlpha(secondLine[x])));
+        }
+    }
+    return difference;
+}
+
+void NinePatchTest::initTestCase()
+{
+    // do not read the configuration of the user
+    QStandardPaths::setTestModeEnabled(true);
+    m_helper.reset(new Helper(KSharedConfig::openConfig()));
+}
+
+void NinePatchTest::testFrames_data()
+{
+    QTest::addColumn<FramePrimitive>("primitive");
+    QTest::addColumn<qreal>("dpr");
+    QTest::addColumn<QColor>("background");
+    QTest::addColumn<QColor>("color");
+    QTest::addColumn<QColor>("outline");
+
+    const struct {
+        FramePrimitive primitive;
+        const char *name;
+    } primitives[] = {
+        { Frame, "frame" },
+        { MenuFrame, "menu" },
+        { TabWidgetFrame, "tabwidget" },
+    };
+
+    const struct {
+        QColor color;
+        const char *name;
+    } backgrounds[] = {
+        { QColor(0xef, 0xf0, 0xf1), "opaque" },
+        { QColor(0x23, 0x26, 0x29, 0x80), "translucent" },
+    };
+
+    const struct {
+        QColor color;
+        QColor outline;
+        const char *name;
+    } styles[] = {
+        { QColor(0x31, 0x36, 0x3b), QColor(), "fill" },
+        { QColor(0x31, 0x36, 0x3b, 0xb0), QColor(), "translucent-fill" },
+        { QColor(), QColor(0x3d, 0xae, 0xe9, 0xc0), "outline" },
+        { QColor(0x31, 0x36, 0x3b), QColor(0x3d, 0xae, 0xe9), "fill-outline" },
+        { QColor(0x31, 0x36, 0x3b, 0xb0), QColor(0x3d, 0xae, 0xe9, 0xc0), "translucent-fill-outline" },
+    };
+
+    for (const auto &primitive : primitives) {
+        for (const qreal dpr : { 1.0, 2.0 }) {
+            for (const auto &background : backgrounds) {
+                for (const auto &style : styles) {
+                    const QByteArray name = QByteArray(primitive.name) + "@" + QByteArray::number(dpr)
+                        + "/" + background.name + "/" + style.name;
+                    QTest::newRow(name.constData()) << primitive.primitive << dpr << background.color
+                        << style.color << style.outline;
+                }
+            }
+        }
+    }
+}
+
+void NinePatchTest::testFrames()
+{
+    QFETCH(FramePrimitive, primitive);
+    QFETCH(qreal, dpr);
+    QFETCH(QColor, background);
+    QFETCH(QColor, color);
+    QFETCH(QColor, outline);
+
+    const QImage direct = paintFrame(m_helper.data(), primitive, dpr, background, color, outline, false);
+    const QImage ninePatch = paintFrame(m_helper.data(), primitive, dpr, background, color, outline, true);
+
+    // single layer frames are identical, see Helper::renderNinePatch()
+    if (!color.isValid() || !outline.isValid()) {
+        QCOMPARE(ninePatch, direct);
+    } else {
+        QVERIFY2(maxDifference(ninePatch, direct) <= 2,
+            qPrintable(QStringLiteral("differs by %1").arg(maxDifference(ninePatch, direct))));
+    }
+}
+
+QTEST_MAIN(NinePatchTest)
+
+#include "ninepatchtest.moc"
@@ -0,0 +1,223 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Benchmark of the rounded path cache of the style helper.
+ *
+ * A widget gallery, --galleries copies of it (10 by default), is painted
+ * --frames times (100 by default) into an image, once with the rounded path
+ * cache and once without, at each painter scale.
+ *
+ * The scales are 1 and 1.25, or the one given with --scale. Scaled painters
+ * bypass the pixmap caches of the helper, as with fractional scaling, so every
+ * frame paints its tabs and tab widget frames directly, and takes their
+ * rounded paths from the cache. At scale 1 the rounded paths are only built
+ * into the cached pixmaps, which do not use the path cache: both runs should
+ * take the same time, without any hit or miss.
+ *
+ * The results are printed as JSON: the paint time of the frames in both runs,
+ * and the hits and misses of the cache.
+ */
+
+#include "fluentbenchmark.h"
+#include "fluenthelper.h"
+#include "fluentstyle.h"
+
+#include <QApplication>
+#include <QCheckBox>
+#include <QComboBox>
+#include <QElapsedTimer>
+#include <QGridLayout>
+#include <QGroupBox>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLineEdit>
+#include <QPainter>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QRadioButton>
+#include <QSlider>
+#include <QStandardPaths>
+#include <QTabBar>
+#include <QTabWidget>
+#include <QTextStream>
+#include <QToolButton>
+#include <QVBoxLayout>
+
+using namespace Fluent;
+
+// One copy of the gallery: tabs in several shapes, and the usual controls.
+static QWidget *createGallery(QWidget *parent, int index)
+{
+    auto gallery = new QGroupBox(QStringLiteral("Gallery %1").arg(index), parent);
+    auto layout = new QGridLayout(gallery);
+
+    const QTabWidget::TabPosition positions[] = { QTabWidget::North, QTabWidget::South, QTabWidget::West, QTabWidget::East };
+    for (int i = 0; i < 4; ++i) {
+        auto tabWidget = new QTabWidget(gallery);
+        tabWidget->setTabPosition(positions[i]);
+        for (int tab = 0; tab < 4; ++tab) {
+            tabWidget->addTab(new QWidget(tabWidget), QStringLiteral("Tab %1").arg(tab));
+        }
+        tabWidget->setCurrentIndex(i);
+        layout->addWidget(tabWidget, 0, i);
+    }
+
+    auto tabBar = new QTabBar(gallery);
+    tabBar->setDocumentMode(true);
+    for (int tab = 0; tab < 6; ++tab) {
+        tabBar->addTab(QStringLiteral("Document %1").arg(tab));
+    }
+    layout->addWidget(tabBar, 1, 0, 1, 4);
+
+    auto pushButton = new QPushButton(QStringLiteral("Push button"), gallery);
+    layout->addWidget(pushButton, 2, 0);
+
+    auto toolButton = new QToolButton(gallery);
+    toolButton->setText(QStringLiteral("Tool button"));
+    toolButton->setCheckable(true);
+    toolButton->setChecked(true);
+    layout->addWidget(toolButton, 2, 1);
+
+    auto checkBox = new QCheckBox(QStringLiteral("Check box"), gallery);
+    checkBox->setChecked(index % 2);
+    layout->addWidget(checkBox, 2, 2);
+
+    auto radioButton = new QRadioButton(QStringLiteral("Radio button"), gallery);
+    radioButton->setChecked(true);
+    layout->addWidget(radioButton, 2, 3);
+
+    auto lineEdit = new QLineEdit(QStringLiteral("Line edit"), gallery);
+    layout->addWidget(lineEdit, 3, 0);
+
+    auto comboBox = new QComboBox(gallery);
+    comboBox->addItem(QStringLiteral("Combo box"));
+    layout->addWidget(comboBox, 3, 1);
+
+    auto slider = new QSlider(Qt::Horizontal, gallery);
+    slider->setValue(10 * (index % 10));
+    layout->addWidget(slider, 3, 2);
+
+    auto progressBar = new QProgressBar(gallery);
+    progressBar->setValue(10 * (index % 10));
+    layout->addWidget(progressBar, 3, 3);
+
+    return gallery;
+}
+
+// Paint the window every frame, returns the paint times.
+static QJsonObject run(Helper &helper, QWidget *window, const char *name, int frames, qreal scale, bool cacheEnabled)
+{
+    helper.setRoundedPathCacheEnabled(cacheEnabled);
+    helper.resetRoundedPathCacheStatistics();
+
+    const QSize size = window->size() * scale;
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+
+    QVector<qreal> paintTimes;
+    for (int frame = 0; frame < frames; ++frame) {
+        image.fill(Qt::transparent);
+
+        QElapsedTimer timer;
+        timer.start();
+        QPainter painter(&image);
+        painter.scale(scale, scale);
+        window->render(&painter);
+        painter.end();
+        paintTimes.append(timer.nsecsElapsed() / 1e6);
+    }
+
+    const Helper::RoundedPathCacheStatistics &statistics = helper.roundedPathCacheStatistics();
+
+    QJsonObject result;
+    result[QStringLiteral("run")] = QLatin1String(name);
+    result[QStringLiteral("scale")] = scale;
+    result[QStringLiteral("frames")] = frames;
+    result[QStringLiteral("paintMs")] = distribution(paintTimes);
+    result[QStringLiteral("pathHits")] = qint64(statistics.hits);
+    result[QStringLiteral("pathMisses")] = qint64(statistics.misses);
+    result[QStringLiteral("pathHitRate")] = statistics.hitRate();
+    return result;
+}
+
+static QString argument(const QStringList &arguments, const QString &name)
+{
+    const int index = arguments.indexOf(name);
+    return index < 0 || index + 1 >= arguments.size() ? QString() : arguments.at(index + 1);
+}
+
+static int intArgument(const QStringList &arguments, const QString &name, int defaultValue)
+{
+    bool ok = false;
+    const int value = argument(arguments, name).toInt(&ok);
+    return ok && value > 0 ? value : defaultValue;
+}
+
+static qreal realArgument(const QStringList &arguments, const QString &name, qreal defaultValue)
+{
+    bool ok = false;
+    const qreal value = argument(arguments, name).toDouble(&ok);
+    return ok && value > 0 ? value : defaultValue;
+}
+
+int main(int argc, char **argv)
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    // do not read nor write the configuration of the user
+    QStandardPaths::setTestModeEnabled(true);
+
+    QApplication app(argc, argv);
+    auto style = new Fluent::Style;
+    QApplication::setStyle(style);
+    Helper &helper = style->helper();
+
+    const QStringList arguments = app.arguments();
+    const int galleries = intArgument(arguments, QStringLiteral("--galleries"), 10);
+    const int frames = intArgument(arguments, QStringLiteral("--frames"), 100);
+    const qreal scaleArgument = realArgument(arguments, QStringLiteral("--scale"), 0);
+    const QVector<qreal> scales = scaleArgument > 0 ? QVector<qreal>{ scaleArgument } : QVector<qreal>{ 1.0, 1.25 };
+
+    QWidget window;
+    auto layout = new QVBoxLayout(&window);
+    for (int i = 0; i < galleries; ++i) {
+        layout->addWidget(createGallery(&window, i));
+    }
+    window.adjustSize();
+    window.ensurePolished();
+
+    QJsonArray results;
+    for (const qreal scale : scales) {
+        // one frame to polish, lay out and fill the caches that do not depend on the run
+        run(helper, &window, "warmup", 1, scale, true);
+
+        results.append(run(helper, &window, "uncached", frames, scale, false));
+        results.append(run(helper, &window, "cached", frames, scale, true));
+    }
+
+    QJsonObject document;
+    document[QStringLiteral("widgets")] = window.findChildren<QWidget *>().size();
+    document[QStringLiteral("size")] = QStringLiteral("%1x%2").arg(window.width()).arg(window.height());
+    document[QStringLiteral("results")] = results;
+
+    QTextStream(stdout) << QJsonDocument(document).toJson();
+    return 0;
+}
@@ -40,6 +40,50 @@ namespace Fluent
     //* contrast for arrow and treeline rendering
     static const qreal arrowShade = 0.15;
 
+    //* number of rounded paths that are kept
+    static const int roundedPathCount = 256;
+
+    //* byte budget of the primitive render cache
+    static const int primitiveCacheSize = 4*1024*1024;
+
+    //* largest cached primitive, in bytes. Bigger ones are painted directly
+    static const int primitiveMaxSize = 256*1024;
+
+    //* corner size of the nine-patches used for large frames. It covers the margin, the radius and the outline
+    static const int ninePatchCornerSize = 2 + Metrics::Frame_FrameRadius;
+
+    //* number of palettes whose color tables are kept
+    static const int colorTableCount = 16;
+
+    //* byte budget of the nine-patch cache
+    static const int ninePatchCacheSize = 256*1024;
+
+    //* device pixel ratio of the device a painter paints on
+    static qreal painterDevicePixelRatio( QPainter* painter )
+    {
+        #if QT_VERSION >= 0x050600
+        return painter->device() ? painter->device()->devicePixelRatioF():1;
+        #elif QT_VERSION >= 0x050000
+        return painter->device() ? painter->device()->devicePixelRatio():1;
+        #else
+        Q_UNUSED( painter );
+        return 1;
+        #endif
+    }
+
+    //* true if blitting a pixmap at given rect gives the same pixels as painting directly: plain painters, on whole device pixels
+    static bool canBlit( QPainter* painter, const QRect& rect, qreal devicePixelRatio )
+    {
+        const QTransform& transform( painter->transform() );
+        const QPointF origin( devicePixelRatio*transform.map( QPointF( rect.topLeft() ) ) );
+        return
+            transform.type() <= QTransform::TxTranslate &&
+            qAbs( origin.x() - qRound( origin.x() ) ) < 0.01 &&
+            qAbs( origin.y() - qRound( origin.y() ) ) < 0.01 &&
+            painter->opacity() >= 1 &&
+            painter->compositionMode() == QPainter::CompositionMode_SourceOver;
+    }
+
     //____________________________________________________________________
     Helper::Helper( KSharedConfig::Ptr config ):
         _config( std::move( config ) )
@@ -70,35 +114,40 @@ namespace Fluent
         _activeTitleBarTextColor = group.readEntry( "activeForeground", palette.color( QPalette::Active, QPalette::HighlightedText ) );
         _inactiveTitleBarColor = group.readEntry( "inactiveBackground", palette.color( QPalette::Disabled, QPalette::Highlight ) );
         _inactiveTitleBarTextColor = group.readEntry( "inactiveForeground", palette.color( QPalette::Disabled, QPalette::HighlightedText ) );
+
+        _primitiveCache.clear();
+        _ninePatchCache.clear();
+
+        // the stateful brushes and the animation steps may have changed
+        _colorTables.clear();
+        _lastColorTable = nullptr;
     }
 
     //____________________________________________________________________
     QColor Helper::frameOutlineColor( const QPalette& palette, bool mouseOver, bool hasFocus, qreal opacity, AnimationMode mode ) const
     {
 
-        QColor outline( KColorUtils::mix( palette.color( QPalette::Window ), palette.color( QPalette::WindowText ), 0.25 ) );
-
-        const QColor focus( palette.color( QPalette::Highlight ) );
-        const QColor hover( KColorUtils::mix( palette.color( QPalette::Window ), palette.color( QPalette::WindowText ), 0.35 ) );
+        const ColorTable& table( colorTable( palette ) );
+        QColor outline( table.frameOutline );
 
         // focus takes precedence over hover
         if( mode == AnimationFocus )
         {
 
-            if( mouseOver ) outline = KColorUtils::mix( hover, focus, opacity );
-            else outline = KColorUtils::mix( outline, focus, opacity );
+            if( mouseOver ) outline = rampColor( table.ramps[ColorTable::FrameHoverToFocus], opacity );
+            else outline = rampColor( table.ramps[ColorTable::FrameOutlineToFocus], opacity );
 
         } else if( hasFocus ) {
 
-            outline = focus;
+            outline = table.frameFocus;
 
         } else if( mode == AnimationHover ) {
 
-            outline = KColorUtils::mix( outline, hover, opacity );
+            outline = rampColor( table.ramps[ColorTable::FrameOutlineToHover], opacity );
 
         } else if( mouseOver ) {
 
-            outline = hover;
+            outline = table.frameHover;
 
         }
 
@@ -176,27 +225,25 @@ namespace Fluent
     QColor Helper::arrowColor( const QPalette& palette, bool mouseOver, bool hasFocus, qreal opacity, AnimationMode mode ) const
     {
 
-        QColor outline( arrowColor( palette, QPalette::WindowText ) );
+        const ColorTable& table( colorTable( palette ) );
+        QColor outline( table.arrow );
         if( mode == AnimationHover )
         {
 
-            const QColor focus( focusColor( palette ) );
-            const QColor hover( hoverColor( palette ) );
-            if( hasFocus ) outline = KColorUtils::mix( focus, hover, opacity );
-            else outline = KColorUtils::mix( outline, hover, opacity );
+            if( hasFocus ) outline = rampColor( table.ramps[ColorTable::FocusToHover], opacity );
+            else outline = rampColor( table.ramps[ColorTable::ArrowToHover], opacity );
 
         } else if( mouseOver ) {
 
-            outline = hoverColor( palette );
+            outline = table.hover;
 
         } else if( mode == AnimationFocus ) {
 
-            const QColor focus( focusColor( palette ) );
-            outline = KColorUtils::mix( outline, focus, opacity );
+            outline = rampColor( table.ramps[ColorTable::ArrowToFocus], opacity );
 
         } else if( hasFocus ) {
 
-            outline = focusColor( palette );
+            outline = table.focus;
 
         }
 
@@ -239,7 +286,7 @@ namespace Fluent
         // } else 
         if( hasFocus ) {
 
-            outline = buttonFocusOutlineColor( palette );
+            outline = colorTable( palette ).buttonFocusOutline;
 
         }
 
@@ -251,9 +298,8 @@ namespace Fluent
     QColor Helper::buttonBackgroundColor( const QPalette& palette, bool mouseOver, bool hasFocus, bool sunken, qreal opacity, AnimationMode mode ) const
     {
 
-        QColor background( sunken ?
-            KColorUtils::mix( palette.color( QPalette::Button ), palette.color( QPalette::ButtonText ), 0.1 ):
-            palette.color( QPalette::Button ) );
+        const ColorTable& table( colorTable( palette ) );
+        QColor background( sunken ? table.buttonSunken:table.button );
 
         if( !sunken )
         {
@@ -261,22 +307,19 @@ namespace Fluent
             if( mode == AnimationHover )
             {
 
-                const QColor focus( focusColor( palette ) );
-                const QColor hover( hoverColor( palette ) );
-                background = KColorUtils::mix( focus, hover, opacity );
+                background = rampColor( table.ramps[ColorTable::FocusToHover], opacity );
 
             } else if( mouseOver ) {
 
-                background = hoverColor( palette );
+                background = table.hover;
 
             } else if( mode == AnimationFocus ) {
 
-                const QColor focus( focusColor( palette ) );
-                background = KColorUtils::mix( background, focus, opacity );
+                background = rampColor( table.ramps[ColorTable::ButtonToFocus], opacity );
 
             } else if( hasFocus ) {
 
-                background = focusColor( palette );
+                background = table.focus;
 
             }
 
@@ -291,34 +334,32 @@ namespace Fluent
     {
 
         QColor outline;
-        const QColor hoverColor( palette.color( QPalette::Button ) );
-        const QColor focusColor( this->focusColor( palette ) );
-        const QColor sunkenColor = KColorUtils::mix( palette.color( QPalette::Button ), palette.color( QPalette::ButtonText ), 0.1 );
+        const ColorTable& table( colorTable( palette ) );
 
         // hover takes precedence over focus
         if( sunken ) {
 
-            outline = sunkenColor;
+            outline = table.buttonSunken;
 
         } else if( mode == AnimationHover )
         {
 
-            if( hasFocus ) outline = KColorUtils::mix( focusColor, hoverColor, opacity );
-            else if( sunken ) outline = sunkenColor;
-            else outline = alphaColor( hoverColor, opacity );
+            if( hasFocus ) outline = rampColor( table.ramps[ColorTable::FocusToButton], opacity );
+            else if( sunken ) outline = table.buttonSunken;
+            else outline = rampColor( table.ramps[ColorTable::ButtonAlpha], opacity );
 
         } else if( mouseOver ) {
 
-            outline = hoverColor;
+            outline = table.button;
 
         } else if( mode == AnimationFocus ) {
 
-            if( sunken ) outline = KColorUtils::mix( sunkenColor, focusColor, opacity );
-            else outline = alphaColor( focusColor, opacity );
+            if( sunken ) outline = rampColor( table.ramps[ColorTable::ButtonSunkenToFocus], opacity );
+            else outline = rampColor( table.ramps[ColorTable::FocusAlpha], opacity );
 
         } else if( hasFocus ) {
 
-            outline = focusColor;
+            outline = table.focus;
 
         }
 
@@ -330,29 +371,27 @@ namespace Fluent
     QColor Helper::scrollBarHandleColor( const QPalette& palette, bool mouseOver, bool hasFocus, qreal opacity, AnimationMode mode ) const
     {
 
-        QColor color( alphaColor( palette.color( QPalette::WindowText ), 0.5 ) );
+        const ColorTable& table( colorTable( palette ) );
+        QColor color( table.scrollBarHandle );
 
         // hover takes precedence over focus
         if( mode == AnimationHover )
         {
 
-            const QColor hover( hoverColor( palette ) );
-            const QColor focus( focusColor( palette ) );
-            if( hasFocus ) color = KColorUtils::mix( focus, hover, opacity );
-            else color = KColorUtils::mix( color, hover, opacity );
+            if( hasFocus ) color = rampColor( table.ramps[ColorTable::FocusToHover], opacity );
+            else color = rampColor( table.ramps[ColorTable::ScrollBarHandleToHover], opacity );
 
         } else if( mouseOver ) {
 
-            color = hoverColor( palette );
+            color = table.hover;
 
         } else if( mode == AnimationFocus ) {
 
-            const QColor focus( focusColor( palette ) );
-            color = KColorUtils::mix( color, focus, opacity );
+            color = rampColor( table.ramps[ColorTable::ScrollBarHandleToFocus], opacity );
 
         } else if( hasFocus ) {
 
-            color = focusColor( palette );
+            color = table.focus;
 
         }
 
@@ -412,6 +451,94 @@ namespace Fluent
         return color;
     }
 
+    //______________________________________________________________________________
+    const Helper::ColorTable& Helper::colorTable( const QPalette& palette ) const
+    {
+
+        const ColorTableKey key( palette.cacheKey(), palette.currentColorGroup() );
+        if( _lastColorTable && _lastColorTableKey == key ) return *_lastColorTable;
+
+        ColorTable* table( _colorTables.object( key ) );
+        if( !table )
+        {
+
+            table = new ColorTable;
+            table->frameOutline = KColorUtils::mix( palette.color( QPalette::Window ), palette.color( QPalette::WindowText ), 0.25 );
+            table->frameHover = KColorUtils::mix( palette.color( QPalette::Window ), palette.color( QPalette::WindowText ), 0.35 );
+            table->frameFocus = palette.color( QPalette::Highlight );
+            table->arrow = arrowColor( palette, QPalette::WindowText );
+            table->focus = focusColor( palette );
+            table->hover = hoverColor( palette );
+            table->buttonFocusOutline = buttonFocusOutlineColor( palette );
+            table->button = palette.color( QPalette::Button );
+            table->buttonSunken = KColorUtils::mix( palette.color( QPalette::Button ), palette.color( QPalette::ButtonText ), 0.1 );
+            table->scrollBarHandle = alphaColor( palette.color( QPalette::WindowText ), 0.5 );
+
+            table->ramps[ColorTable::FrameOutlineToFocus] = colorRamp( table->frameOutline, table->frameFocus );
+            table->ramps[ColorTable::FrameHoverToFocus] = colorRamp( table->frameHover, table->frameFocus );
+            table->ramps[ColorTable::FrameOutlineToHover] = colorRamp( table->frameOutline, table->frameHover );
+            table->ramps[ColorTable::FocusToHover] = colorRamp( table->focus, table->hover );
+            table->ramps[ColorTable::ArrowToHover] = colorRamp( table->arrow, table->hover );
+            table->ramps[ColorTable::ArrowToFocus] = colorRamp( table->arrow, table->focus );
+            table->ramps[ColorTable::ButtonToFocus] = colorRamp( table->button, table->focus );
+            table->ramps[ColorTable::FocusToButton] = colorRamp( table->focus, table->button );
+            table->ramps[ColorTable::ButtonAlpha] = colorRamp( table->button, QColor(), true );
+            table->ramps[ColorTable::ButtonSunkenToFocus] = colorRamp( table->buttonSunken, table->focus );
+            table->ramps[ColorTable::FocusAlpha] = colorRamp( table->focus, QColor(), true );
+            table->ramps[ColorTable::ScrollBarHandleToHover] = colorRamp( table->scrollBarHandle, table->hover );
+            table->ramps[ColorTable::ScrollBarHandleToFocus] = colorRamp( table->scrollBarHandle, table->focus );
+
+            _colorTables.insert( key, table );
+
+        }
+
+        _lastColorTableKey = key;
+        _lastColorTable = table;
+        return *table;
+
+    }
+
+    //______________________________________________________________________________
+    Helper::ColorRamp Helper::colorRamp( const QColor& first, const QColor& second, bool alpha ) const
+    {
+
+        ColorRamp ramp;
+        ramp.first = first;
+        ramp.second = second;
+        ramp.alpha = alpha;
+        return ramp;
+
+    }
+
+    //______________________________________________________________________________
+    QColor Helper::rampColor( const ColorRamp& ramp, qreal opacity ) const
+    {
+
+        // animation opacities are digitized to multiples of 1/steps, the ramp stores the color of each.
+        // It is filled on first use, since palettes that are merged for enability transitions are short lived
+        const int steps( AnimationData::steps() );
+        if( steps > 0 && ramp.steps.isEmpty() )
+        {
+            ramp.steps.reserve( steps + 1 );
+            for( int i = 0; i <= steps; ++i )
+            {
+                const qreal value( qreal( i )/steps );
+                ramp.steps.append( ramp.alpha ? alphaColor( ramp.first, value ):KColorUtils::mix( ramp.first, ramp.second, value ) );
+            }
+        }
+
+        if( steps > 0 && ramp.steps.size() == steps + 1 )
+        {
+            const qreal position( opacity*steps );
+            const int index( qRound( position ) );
+            if( index >= 0 && index <= steps && qAbs( position - index ) < 0.001 )
+            { return ramp.steps[index]; }
+        }
+
+        return ramp.alpha ? alphaColor( ramp.first, opacity ):KColorUtils::mix( ramp.first, ramp.second, opacity );
+
+    }
+
     //______________________________________________________________________________
     void Helper::renderDebugFrame( QPainter* painter, const QRect& rect ) const
     {
@@ -482,31 +609,36 @@ namespace Fluent
         const QColor& color, const QColor& outline ) const
     {
 
-        painter->setRenderHint( QPainter::Antialiasing );
+        renderNinePatch( painter, rect, primitiveKey( painter, PrimitiveFrame, QSize(), color, outline ), [&]( QPainter* painter, const QRect& rect )
+        {
 
-        QRectF frameRect( rect.adjusted( 1, 1, -1, -1 ) );
-        qreal radius( frameRadius() );
+            painter->setRenderHint( QPainter::Antialiasing );
 
-        // set pen
-        if( outline.isValid() )
-        {
+            QRectF frameRect( rect.adjusted( 1, 1, -1, -1 ) );
+            qreal radius( frameRadius() );
 
-            painter->setPen( outline );
-            frameRect.adjust( 0.5, 0.5, -0.5, -0.5 );
-            radius = qMax( radius - 1, qreal( 0.0 ) );
+            // set pen
+            if( outline.isValid() )
+            {
 
-        } else {
+                painter->setPen( outline );
+                frameRect.adjust( 0.5, 0.5, -0.5, -0.5 );
+                radius = qMax( radius - 1, qreal( 0.0 ) );
 
-            painter->setPen( Qt::NoPen );
+            } else {
 
-        }
+                painter->setPen( Qt::NoPen );
 
-        // set brush
-        if( color.isValid() ) painter->setBrush( color );
-        else painter->setBrush( Qt::NoBrush );
+            }
 
-        // render
-        painter->drawRoundedRect( frameRect, radius, radius );
+            // set brush
+            if( color.isValid() ) painter->setBrush( color );
+            else painter->setBrush( Qt::NoBrush );
+
+            // render
+            painter->drawRoundedRect( frameRect, radius, radius );
+
+        } );
 
     }
 
@@ -562,33 +694,41 @@ namespace Fluent
         const QColor& color, const QColor& outline, bool roundCorners ) const
     {
 
-
-        // set brush
-        if( color.isValid() ) painter->setBrush( color );
-        else painter->setBrush( Qt::NoBrush );
-
         if( roundCorners )
         {
 
-            painter->setRenderHint( QPainter::Antialiasing );
-            QRectF frameRect( rect );
-            qreal radius( frameRadius() );
-
-            // set pen
-            if( outline.isValid() )
+            renderNinePatch( painter, rect, primitiveKey( painter, PrimitiveMenuFrame, QSize(), color, outline ), [&]( QPainter* painter, const QRect& rect )
             {
 
-                painter->setPen( outline );
-                frameRect.adjust( 0.5, 0.5, -0.5, -0.5 );
-                radius = qMax( radius, qreal( 0.0 ) );
+                // set brush
+                if( color.isValid() ) painter->setBrush( color );
+                else painter->setBrush( Qt::NoBrush );
 
-            } else painter->setPen( Qt::NoPen );
+                painter->setRenderHint( QPainter::Antialiasing );
+                QRectF frameRect( rect );
+                qreal radius( frameRadius() );
 
-            // render
-            painter->drawRoundedRect( frameRect, radius, radius );
+                // set pen
+                if( outline.isValid() )
+                {
+
+                    painter->setPen( outline );
+                    frameRect.adjust( 0.5, 0.5, -0.5, -0.5 );
+                    radius = qMax( radius, qreal( 0.0 ) );
+
+                } else painter->setPen( Qt::NoPen );
+
+                // render
+                painter->drawRoundedRect( frameRect, radius, radius );
+
+            } );
 
         } else {
 
+            // set brush
+            if( color.isValid() ) painter->setBrush( color );
+            else painter->setBrush( Qt::NoBrush );
+
             painter->setRenderHint( QPainter::Antialiasing, false );
             QRect frameRect( rect );
             if( outline.isValid() )
@@ -612,48 +752,53 @@ namespace Fluent
         bool hasFocus, bool sunken ) const
     {
 
-        // setup painter
-        painter->setRenderHint( QPainter::Antialiasing, true );
+        renderCached( painter, rect, primitiveKey( painter, PrimitiveButtonFrame, rect.size(), color, outline, QColor(), sunken ), [&]( QPainter* painter, const QRect& rect )
+        {
 
-        // copy rect
-        QRectF frameRect( rect );
-        frameRect.adjust( 1, 1, -1, -1 );
-        qreal radius( frameRadius() );
+            // setup painter
+            painter->setRenderHint( QPainter::Antialiasing, true );
 
-        // shadow
-        if( sunken ) {
+            // copy rect
+            QRectF frameRect( rect );
+            frameRect.adjust( 1, 1, -1, -1 );
+            qreal radius( frameRadius() );
 
-            frameRect.translate( 1, 1 );
+            // shadow
+            if( sunken ) {
 
-        // } else if( shadow.isValid() ) {
+                frameRect.translate( 1, 1 );
 
-        //     const qreal shadowRadius = qMax( radius - 1, qreal( 0.0 ) );
-        //     painter->setPen( QPen( shadow, 2 ) );
-        //     painter->setBrush( Qt::NoBrush );
-        //     painter->drawRoundedRect( shadowRect( frameRect ), shadowRadius, shadowRadius );
+            // } else if( shadow.isValid() ) {
 
-        }
+            //     const qreal shadowRadius = qMax( radius - 1, qreal( 0.0 ) );
+            //     painter->setPen( QPen( shadow, 2 ) );
+            //     painter->setBrush( Qt::NoBrush );
+            //     painter->drawRoundedRect( shadowRect( frameRect ), shadowRadius, shadowRadius );
 
-        if( outline.isValid() )
-        {
+            }
 
-            painter->setPen( QPen( outline, 1 ) );
+            if( outline.isValid() )
+            {
 
-            frameRect.adjust( 0.5, 0.5, -0.5, -0.5 );
-            radius = qMax( radius - 1, qreal( 0.0 ) );
+                painter->setPen( QPen( outline, 1 ) );
 
-        } else painter->setPen( Qt::NoPen );
+                frameRect.adjust( 0.5, 0.5, -0.5, -0.5 );
+                radius = qMax( radius - 1, qreal( 0.0 ) );
 
-        // content
-        if( color.isValid() )
-        {
+            } else painter->setPen( Qt::NoPen );
 
-            painter->setBrush( color );
+            // content
+            if( color.isValid() )
+            {
 
-        } else painter->setBrush( Qt::NoBrush );
+                painter->setBrush( color );
 
-        // render
-        painter->drawRoundedRect( frameRect, radius, radius );
+            } else painter->setBrush( Qt::NoBrush );
+
+            // render
+            painter->drawRoundedRect( frameRect, radius, radius );
+
+        } );
 
     }
 
@@ -666,15 +811,20 @@ namespace Fluent
         // do nothing for invalid color
         if( !color.isValid() ) return;
 
-        // setup painter
-        painter->setRenderHints( QPainter::Antialiasing );
+        renderCached( painter, rect, primitiveKey( painter, PrimitiveToolButtonFrame, rect.size(), color ), [&]( QPainter* painter, const QRect& rect )
+        {
 
-        const qreal radius( frameRadius() );
+            // setup painter
+            painter->setRenderHints( QPainter::Antialiasing );
 
-        painter->setPen( Qt::NoPen );
-        painter->setBrush( color );
+            const qreal radius( frameRadius() );
+
+            painter->setPen( Qt::NoPen );
+            painter->setBrush( color );
+
+            painter->drawRoundedRect( rect, radius, radius );
 
-        painter->drawRoundedRect( rect, radius, radius );
+        } );
 
     }
 
@@ -726,28 +876,34 @@ namespace Fluent
         const QColor& color, const QColor& outline, Corners corners ) const
     {
 
-        painter->setRenderHint( QPainter::Antialiasing );
+        renderNinePatch( painter, rect, primitiveKey( painter, PrimitiveTabWidgetFrame, QSize(), color, outline, QColor(), corners ), [&]( QPainter* painter, const QRect& rect )
+        {
 
-        QRectF frameRect( rect.adjusted( 1, 1, -1, -1 ) );
-        qreal radius( frameRadius() );
+            painter->setRenderHint( QPainter::Antialiasing );
 
-        // set pen
-        if( outline.isValid() )
-        {
+            QRectF frameRect( rect.adjusted( 1, 1, -1, -1 ) );
+            qreal radius( frameRadius() );
 
-            painter->setPen( outline );
-            frameRect.adjust( 0.5, 0.5, -0.5, -0.5 );
-            radius = qMax( radius-1, qreal( 0.0 ) );
+            // set pen
+            if( outline.isValid() )
+            {
 
-        } else painter->setPen( Qt::NoPen );
+                painter->setPen( outline );
+                frameRect.adjust( 0.5, 0.5, -0.5, -0.5 );
+                radius = qMax( radius-1, qreal( 0.0 ) );
 
-        // set brush
-        if( color.isValid() ) painter->setBrush( color );
-        else painter->setBrush( Qt::NoBrush );
+            } else painter->setPen( Qt::NoPen );
 
-        // render
-        QPainterPath path( roundedPath( frameRect, corners, radius ) );
-        painter->drawPath( path );
+            // set brush
+            if( color.isValid() ) painter->setBrush( color );
+            else painter->setBrush( Qt::NoBrush );
+
+            // render, the cached path is at the origin
+            painter->translate( frameRect.topLeft() );
+            painter->drawPath( roundedPath( frameRect.size(), corners, radius ) );
+            painter->translate( -frameRect.topLeft() );
+
+        } );
 
     }
 
@@ -798,18 +954,23 @@ namespace Fluent
         const QColor& color, bool sunken ) const
     {
 
-        // setup painter
-        painter->setRenderHint( QPainter::Antialiasing, true );
+        renderCached( painter, rect, primitiveKey( painter, PrimitiveCheckBoxBackground, rect.size(), color, QColor(), QColor(), sunken ), [&]( QPainter* painter, const QRect& rect )
+        {
 
-        // copy rect and radius
-        QRectF frameRect( rect );
-        frameRect.adjust( 3, 3, -3, -3 );
+            // setup painter
+            painter->setRenderHint( QPainter::Antialiasing, true );
 
-        if( sunken ) frameRect.translate(1, 1);
+            // copy rect and radius
+            QRectF frameRect( rect );
+            frameRect.adjust( 3, 3, -3, -3 );
 
-        painter->setPen( Qt::NoPen );
-        painter->setBrush( color );
-        painter->drawRect( frameRect );
+            if( sunken ) frameRect.translate(1, 1);
+
+            painter->setPen( Qt::NoPen );
+            painter->setBrush( color );
+            painter->drawRect( frameRect );
+
+        } );
 
     }
 
@@ -820,86 +981,95 @@ namespace Fluent
         bool sunken, CheckBoxState state, qreal animation ) const
     {
 
-        // setup painter
-        painter->setRenderHint( QPainter::Antialiasing, true );
-
-        // copy rect and radius
-        QRectF frameRect( rect );
-        frameRect.adjust( 2, 2, -2, -2 );
-        qreal radius( frameRadius() );
+        // animated marks are painted at quantized progress, so that they can be shared
+        const int step( state == CheckAnimated ? quantizedAnimation( animation ):0 );
+        animation = qreal( step )/AnimationSteps;
 
-        // shadow
-        if( sunken )
+        renderCached( painter, rect, primitiveKey( painter, PrimitiveCheckBox, rect.size(), color, QColor(), shadow, sunken | ( state << 1 ), step ), [&]( QPainter* painter, const QRect& rect )
         {
 
-            frameRect.translate(1, 1);
+            // setup painter
+            painter->setRenderHint( QPainter::Antialiasing, true );
 
-        } else {
+            // copy rect and radius
+            QRectF frameRect( rect );
+            frameRect.adjust( 2, 2, -2, -2 );
+            qreal radius( frameRadius() );
 
-            painter->setPen( QPen( shadow, 1 ) );
-            painter->setBrush( Qt::NoBrush );
+            // shadow
+            if( sunken )
+            {
 
-            const qreal shadowRadius( radius + 0.5 );
-            painter->drawRoundedRect( shadowRect( frameRect ).adjusted( -0.5, -0.5, 0.5, 0.5 ), shadowRadius, shadowRadius );
+                frameRect.translate(1, 1);
 
-        }
+            } else {
 
-        // content
-        {
+                painter->setPen( QPen( shadow, 1 ) );
+                painter->setBrush( Qt::NoBrush );
 
-            painter->setPen( QPen( color, 1 ) );
-            painter->setBrush( Qt::NoBrush );
+                const qreal shadowRadius( radius + 0.5 );
+                painter->drawRoundedRect( shadowRect( frameRect ).adjusted( -0.5, -0.5, 0.5, 0.5 ), shadowRadius, shadowRadius );
 
-            radius = qMax( radius-1, qreal( 0.0 ) );
-            const QRectF contentRect( frameRect.adjusted( 0.5, 0.5, -0.5, -0.5 ) );
-            painter->drawRoundedRect( contentRect, radius, radius );
+            }
 
-        }
+            // content
+            {
 
-        // mark
-        if( state == CheckOn )
-        {
+                painter->setPen( QPen( color, 1 ) );
+                painter->setBrush( Qt::NoBrush );
 
-            painter->setBrush( color );
-            painter->setPen( Qt::NoPen );
+                radius = qMax( radius-1, qreal( 0.0 ) );
+                const QRectF contentRect( frameRect.adjusted( 0.5, 0.5, -0.5, -0.5 ) );
+                painter->drawRoundedRect( contentRect, radius, radius );
+
+            }
 
-            const QRectF markerRect( frameRect.adjusted( 3, 3, -3, -3 ) );
-            painter->drawRect( markerRect );
+            // mark
+            if( state == CheckOn )
+            {
 
-        } else if( state == CheckPartial ) {
+                painter->setBrush( color );
+                painter->setPen( Qt::NoPen );
 
-            QPen pen( color, 2 );
-            pen.setJoinStyle( Qt::MiterJoin );
-            painter->setPen( pen );
+                const QRectF markerRect( frameRect.adjusted( 3, 3, -3, -3 ) );
+                painter->drawRect( markerRect );
 
-            const QRectF markerRect( frameRect.adjusted( 4, 4, -4, -4 ) );
-            painter->drawRect( markerRect );
+            } else if( state == CheckPartial ) {
 
-            painter->setPen( Qt::NoPen );
-            painter->setBrush( color );
-            painter->setRenderHint( QPainter::Antialiasing, false );
+                QPen pen( color, 2 );
+                pen.setJoinStyle( Qt::MiterJoin );
+                painter->setPen( pen );
 
-            QPainterPath path;
-            path.moveTo( markerRect.topLeft() );
-            path.lineTo( markerRect.right() - 1, markerRect.top() );
-            path.lineTo( markerRect.left(), markerRect.bottom()-1 );
-            painter->drawPath( path );
+                const QRectF markerRect( frameRect.adjusted( 4, 4, -4, -4 ) );
+                painter->drawRect( markerRect );
 
-        } else if( state == CheckAnimated ) {
+                painter->setPen( Qt::NoPen );
+                painter->setBrush( color );
+                painter->setRenderHint( QPainter::Antialiasing, false );
 
-            const QRectF markerRect( frameRect.adjusted( 3, 3, -3, -3 ) );
-            QPainterPath path;
-            path.moveTo( markerRect.topRight() );
-            path.lineTo( markerRect.center() + animation*( markerRect.topLeft() - markerRect.center() ) );
-            path.lineTo( markerRect.bottomLeft() );
-            path.lineTo( markerRect.center() + animation*( markerRect.bottomRight() - markerRect.center() ) );
-            path.closeSubpath();
+                QPainterPath path;
+                path.moveTo( markerRect.topLeft() );
+                path.lineTo( markerRect.right() - 1, markerRect.top() );
+                path.lineTo( markerRect.left(), markerRect.bottom()-1 );
+                painter->drawPath( path );
 
-            painter->setBrush( color );
-            painter->setPen( Qt::NoPen );
-            painter->drawPath( path );
+            } else if( state == CheckAnimated ) {
 
-        }
+                const QRectF markerRect( frameRect.adjusted( 3, 3, -3, -3 ) );
+                QPainterPath path;
+                path.moveTo( markerRect.topRight() );
+                path.lineTo( markerRect.center() + animation*( markerRect.topLeft() - markerRect.center() ) );
+                path.lineTo( markerRect.bottomLeft() );
+                path.lineTo( markerRect.center() + animation*( markerRect.bottomRight() - markerRect.center() ) );
+                path.closeSubpath();
+
+                painter->setBrush( color );
+                painter->setPen( Qt::NoPen );
+                painter->drawPath( path );
+
+            }
+
+        } );
 
     }
 
@@ -907,17 +1077,22 @@ namespace Fluent
     void Helper::renderRadioButtonBackground( QPainter* painter, const QRect& rect, const QColor& color, bool sunken ) const
     {
 
-        // setup painter
-        painter->setRenderHint( QPainter::Antialiasing, true );
+        renderCached( painter, rect, primitiveKey( painter, PrimitiveRadioButtonBackground, rect.size(), color, QColor(), QColor(), sunken ), [&]( QPainter* painter, const QRect& rect )
+        {
 
-        // copy rect
-        QRectF frameRect( rect );
-        frameRect.adjust( 3, 3, -3, -3 );
-        if( sunken ) frameRect.translate(1, 1);
+            // setup painter
+            painter->setRenderHint( QPainter::Antialiasing, true );
 
-        painter->setPen( Qt::NoPen );
-        painter->setBrush( color );
-        painter->drawEllipse( frameRect );
+            // copy rect
+            QRectF frameRect( rect );
+            frameRect.adjust( 3, 3, -3, -3 );
+            if( sunken ) frameRect.translate(1, 1);
+
+            painter->setPen( Qt::NoPen );
+            painter->setBrush( color );
+            painter->drawEllipse( frameRect );
+
+        } );
 
     }
 
@@ -928,62 +1103,71 @@ namespace Fluent
         bool sunken, RadioButtonState state, qreal animation ) const
     {
 
-        // setup painter
-        painter->setRenderHint( QPainter::Antialiasing, true );
+        // animated marks are painted at quantized progress, so that they can be shared
+        const int step( state == RadioAnimated ? quantizedAnimation( animation ):0 );
+        animation = qreal( step )/AnimationSteps;
 
-        // copy rect
-        QRectF frameRect( rect );
-        frameRect.adjust( 2, 2, -2, -2 );
-
-        // shadow
-        if( sunken )
+        renderCached( painter, rect, primitiveKey( painter, PrimitiveRadioButton, rect.size(), color, QColor(), shadow, sunken | ( state << 1 ), step ), [&]( QPainter* painter, const QRect& rect )
         {
 
-            frameRect.translate( 1, 1 );
+            // setup painter
+            painter->setRenderHint( QPainter::Antialiasing, true );
 
-        } else {
+            // copy rect
+            QRectF frameRect( rect );
+            frameRect.adjust( 2, 2, -2, -2 );
 
-            painter->setPen( QPen( shadow, 1 ) );
-            painter->setBrush( Qt::NoBrush );
-            painter->drawEllipse( shadowRect( frameRect ).adjusted( -0.5, -0.5, 0.5, 0.5 ) );
+            // shadow
+            if( sunken )
+            {
 
-        }
+                frameRect.translate( 1, 1 );
 
-        // content
-        {
+            } else {
 
-            painter->setPen( QPen( color, 1 ) );
-            painter->setBrush( Qt::NoBrush );
+                painter->setPen( QPen( shadow, 1 ) );
+                painter->setBrush( Qt::NoBrush );
+                painter->drawEllipse( shadowRect( frameRect ).adjusted( -0.5, -0.5, 0.5, 0.5 ) );
 
-            const QRectF contentRect( frameRect.adjusted( 0.5, 0.5, -0.5, -0.5 ) );
-            painter->drawEllipse( contentRect );
+            }
 
-        }
+            // content
+            {
 
-        // mark
-        if( state == RadioOn )
-        {
+                painter->setPen( QPen( color, 1 ) );
+                painter->setBrush( Qt::NoBrush );
 
-            painter->setBrush( color );
-            painter->setPen( Qt::NoPen );
+                const QRectF contentRect( frameRect.adjusted( 0.5, 0.5, -0.5, -0.5 ) );
+                painter->drawEllipse( contentRect );
 
-            const QRectF markerRect( frameRect.adjusted( 3, 3, -3, -3 ) );
-            painter->drawEllipse( markerRect );
+            }
 
-        } else if( state == RadioAnimated ) {
+            // mark
+            if( state == RadioOn )
+            {
 
-            painter->setBrush( color );
-            painter->setPen( Qt::NoPen );
-            QRectF markerRect( frameRect.adjusted( 3, 3, -3, -3 ) );
+                painter->setBrush( color );
+                painter->setPen( Qt::NoPen );
 
-            painter->translate( markerRect.center() );
-            painter->rotate( 45 );
+                const QRectF markerRect( frameRect.adjusted( 3, 3, -3, -3 ) );
+                painter->drawEllipse( markerRect );
 
-            markerRect.setWidth( markerRect.width()*animation );
-            markerRect.translate( -markerRect.center() );
-            painter->drawEllipse( markerRect );
+            } else if( state == RadioAnimated ) {
 
-        }
+                painter->setBrush( color );
+                painter->setPen( Qt::NoPen );
+                QRectF markerRect( frameRect.adjusted( 3, 3, -3, -3 ) );
+
+                painter->translate( markerRect.center() );
+                painter->rotate( 45 );
+
+                markerRect.setWidth( markerRect.width()*animation );
+                markerRect.translate( -markerRect.center() );
+                painter->drawEllipse( markerRect );
+
+            }
+
+        } );
 
     }
 
@@ -1093,21 +1277,26 @@ namespace Fluent
         bool sunken ) const
     {
 
-        // setup painter
-        painter->setRenderHint( QPainter::Antialiasing, true );
+        renderCached( painter, rect, primitiveKey( painter, PrimitiveSliderHandle, rect.size(), color ), [&]( QPainter* painter, const QRect& rect )
+        {
 
-        // copy rect
-        QRectF frameRect( rect );
-        frameRect.adjust( 1, 1, -1, -1 );
+            // setup painter
+            painter->setRenderHint( QPainter::Antialiasing, true );
 
-        painter->setPen( Qt::NoPen );
+            // copy rect
+            QRectF frameRect( rect );
+            frameRect.adjust( 1, 1, -1, -1 );
 
-        // set brush
-        if( color.isValid() ) painter->setBrush( color );
-        else painter->setBrush( Qt::NoBrush );
+            painter->setPen( Qt::NoPen );
 
-        // render
-        painter->drawEllipse( frameRect );
+            // set brush
+            if( color.isValid() ) painter->setBrush( color );
+            else painter->setBrush( Qt::NoBrush );
+
+            // render
+            painter->drawEllipse( frameRect );
+
+        } );
 
     }
 
@@ -1216,138 +1405,165 @@ namespace Fluent
     void Helper::renderTabBarTab( QPainter* painter, const QRect& rect, const QColor& color, const QColor& outline, Corners corners ) const
     {
 
-        // setup painter
-        painter->setRenderHint( QPainter::Antialiasing, true );
+        renderCached( painter, rect, primitiveKey( painter, PrimitiveTabBarTab, rect.size(), color, outline, QColor(), corners ), [&]( QPainter* painter, const QRect& rect )
+        {
 
-        QRectF frameRect( rect );
-        qreal radius( frameRadius() );
+            // setup painter
+            painter->setRenderHint( QPainter::Antialiasing, true );
 
-        // pen
-        if( outline.isValid() )
-        {
+            QRectF frameRect( rect );
+            qreal radius( frameRadius() );
 
-            painter->setPen( outline );
-            frameRect.adjust( 0.5, 0.5, -0.5, -0.5 );
-            radius = qMax( radius-1, qreal( 0.0 ) );
+            // pen
+            if( outline.isValid() )
+            {
+
+                painter->setPen( outline );
+                frameRect.adjust( 0.5, 0.5, -0.5, -0.5 );
+                radius = qMax( radius-1, qreal( 0.0 ) );
+
+            } else painter->setPen( Qt::NoPen );
 
-        } else painter->setPen( Qt::NoPen );
 
+            // brush
+            if( color.isValid() ) painter->setBrush( color );
+            else painter->setBrush( Qt::NoBrush );
 
-        // brush
-        if( color.isValid() ) painter->setBrush( color );
-        else painter->setBrush( Qt::NoBrush );
+            // render, the cached path is at the origin
+            painter->translate( frameRect.topLeft() );
+            painter->drawPath( roundedPath( frameRect.size(), corners, radius ) );
+            painter->translate( -frameRect.topLeft() );
 
-        // render
-        QPainterPath path( roundedPath( frameRect, corners, radius ) );
-        painter->drawPath( path );
+        } );
 
     }
 
     //______________________________________________________________________________
     void Helper::renderArrow( QPainter* painter, const QRect& rect, const QColor& color, ArrowOrientation orientation ) const
     {
-        // define polygon
-        QPolygonF arrow;
-        switch( orientation )
+
+        // only the area around the center is painted, cache that
+        QRect arrowRect( rect );
+        if( rect.width() > 12 ) arrowRect.adjust( ( rect.width() - 12 )/2, 0, -( rect.width() - 12 )/2, 0 );
+        if( rect.height() > 12 ) arrowRect.adjust( 0, ( rect.height() - 12 )/2, 0, -( rect.height() - 12 )/2 );
+
+        renderCached( painter, arrowRect, primitiveKey( painter, PrimitiveArrow, arrowRect.size(), color, QColor(), QColor(), orientation ), [&]( QPainter* painter, const QRect& rect )
         {
-            case ArrowUp: arrow = QVector<QPointF>{QPointF( -4, 2 ), QPointF( 0, -2 ), QPointF( 4, 2 )}; break;
-            case ArrowDown: arrow = QVector<QPointF>{QPointF( -4, -2 ), QPointF( 0, 2 ), QPointF( 4, -2 )}; break;
-            case ArrowLeft: arrow = QVector<QPointF>{QPointF( 2, -4 ), QPointF( -2, 0 ), QPointF( 2, 4 )}; break;
-            case ArrowRight: arrow = QVector<QPointF>{QPointF( -2, -4 ), QPointF( 2, 0 ), QPointF( -2, 4 )}; break;
-            default: break;
-        }
 
-        painter->save();
-        painter->setRenderHints( QPainter::Antialiasing );
-        painter->translate( QRectF( rect ).center() );
-        painter->setBrush( Qt::NoBrush );
-        painter->setPen( QPen( color, 1.1 ) );
-        painter->drawPolyline( arrow );
-        painter->restore();
+            // define polygon
+            QPolygonF arrow;
+            switch( orientation )
+            {
+                case ArrowUp: arrow = QVector<QPointF>{QPointF( -4, 2 ), QPointF( 0, -2 ), QPointF( 4, 2 )}; break;
+                case ArrowDown: arrow = QVector<QPointF>{QPointF( -4, -2 ), QPointF( 0, 2 ), QPointF( 4, -2 )}; break;
+                case ArrowLeft: arrow = QVector<QPointF>{QPointF( 2, -4 ), QPointF( -2, 0 ), QPointF( 2, 4 )}; break;
+                case ArrowRight: arrow = QVector<QPointF>{QPointF( -2, -4 ), QPointF( 2, 0 ), QPointF( -2, 4 )}; break;
+                default: break;
+            }
+
+            painter->save();
+            painter->setRenderHints( QPainter::Antialiasing );
+            painter->translate( QRectF( rect ).center() );
+            painter->setBrush( Qt::NoBrush );
+            painter->setPen( QPen( color, 1.1 ) );
+            painter->drawPolyline( arrow );
+            painter->restore();
+
+        } );
+
    }
 
     //______________________________________________________________________________
     void Helper::renderDecorationButton( QPainter* painter, const QRect& rect, const QColor& color, ButtonType buttonType, bool inverted ) const
     {
 
-        painter->save();
-        painter->setViewport( rect );
-        painter->setWindow( 0, 0, 18, 18 );
-        painter->setRenderHints( QPainter::Antialiasing );
-
-        // initialize pen
-        QPen pen;
-        pen.setCapStyle( Qt::RoundCap );
-        pen.setJoinStyle( Qt::MiterJoin );
-
-        if( inverted )
+        const PrimitiveRenderer render = [&]( QPainter* painter, const QRect& rect )
         {
-            // render circle
-            painter->setPen( Qt::NoPen );
-            painter->setBrush( color );
-            painter->drawEllipse( QRectF( 0, 0, 18, 18 ) );
 
-            // take out the inner part
-            painter->setCompositionMode( QPainter::CompositionMode_DestinationOut );
-            painter->setBrush( Qt::NoBrush );
-            pen.setColor( Qt::black );
+            painter->save();
+            painter->setViewport( rect );
+            painter->setWindow( 0, 0, 18, 18 );
+            painter->setRenderHints( QPainter::Antialiasing );
 
-        } else {
+            // initialize pen
+            QPen pen;
+            pen.setCapStyle( Qt::RoundCap );
+            pen.setJoinStyle( Qt::MiterJoin );
 
-            painter->setBrush( Qt::NoBrush );
-            pen.setColor( color );
+            if( inverted )
+            {
+                // render circle
+                painter->setPen( Qt::NoPen );
+                painter->setBrush( color );
+                painter->drawEllipse( QRectF( 0, 0, 18, 18 ) );
 
-        }
+                // take out the inner part
+                painter->setCompositionMode( QPainter::CompositionMode_DestinationOut );
+                painter->setBrush( Qt::NoBrush );
+                pen.setColor( Qt::black );
 
-        pen.setCapStyle( Qt::RoundCap );
-        pen.setJoinStyle( Qt::MiterJoin );
-        pen.setWidthF( 1.1*qMax(1.0, 18.0/rect.width() ) );
-        painter->setPen( pen );
+            } else {
 
-        switch( buttonType )
-        {
-            case ButtonClose:
-            {
-                painter->drawLine( QPointF( 5, 5 ), QPointF( 13, 13 ) );
-                painter->drawLine( 13, 5, 5, 13 );
-                break;
-            }
+                painter->setBrush( Qt::NoBrush );
+                pen.setColor( color );
 
-            case ButtonMaximize:
-            {
-                painter->drawPolyline( QVector<QPointF>{
-                    QPointF( 4, 11 ),
-                    QPointF( 9, 6 ),
-                    QPointF( 14, 11 )});
-                break;
             }
 
-            case ButtonMinimize:
-            {
-
-                painter->drawPolyline(QVector<QPointF>{
-                    QPointF( 4, 7 ),
-                    QPointF( 9, 12 ),
-                    QPointF( 14, 7 )} );
-                break;
-            }
+            pen.setCapStyle( Qt::RoundCap );
+            pen.setJoinStyle( Qt::MiterJoin );
+            pen.setWidthF( 1.1*qMax(1.0, 18.0/rect.width() ) );
+            painter->setPen( pen );
 
-            case ButtonRestore:
+            switch( buttonType )
             {
-                pen.setJoinStyle( Qt::RoundJoin );
-                painter->setPen( pen );
-                painter->drawPolygon( QVector<QPointF>{
-                    QPointF( 4.5, 9 ),
-                    QPointF( 9, 4.5 ),
-                    QPointF( 13.5, 9 ),
-                    QPointF( 9, 13.5 )});
-                break;
+                case ButtonClose:
+                {
+                    painter->drawLine( QPointF( 5, 5 ), QPointF( 13, 13 ) );
+                    painter->drawLine( 13, 5, 5, 13 );
+                    break;
+                }
+
+                case ButtonMaximize:
+                {
+                    painter->drawPolyline( QVector<QPointF>{
+                        QPointF( 4, 11 ),
+                        QPointF( 9, 6 ),
+                        QPointF( 14, 11 )});
+                    break;
+                }
+
+                case ButtonMinimize:
+                {
+
+                    painter->drawPolyline(QVector<QPointF>{
+                        QPointF( 4, 7 ),
+                        QPointF( 9, 12 ),
+                        QPointF( 14, 7 )} );
+                    break;
+                }
+
+                case ButtonRestore:
+                {
+                    pen.setJoinStyle( Qt::RoundJoin );
+                    painter->setPen( pen );
+                    painter->drawPolygon( QVector<QPointF>{
+                        QPointF( 4.5, 9 ),
+                        QPointF( 9, 4.5 ),
+                        QPointF( 13.5, 9 ),
+                        QPointF( 9, 13.5 )});
+                    break;
+                }
+
+                default: break;
             }
 
-            default: break;
-        }
+            painter->restore();
 
-        painter->restore();
+        };
+
+        // the inverted button punches through what is already painted, it cannot be blitted
+        if( inverted ) render( painter, rect );
+        else renderCached( painter, rect, primitiveKey( painter, PrimitiveDecorationButton, rect.size(), color, QColor(), QColor(), buttonType ), render );
 
     }
 
@@ -1383,7 +1599,7 @@ namespace Fluent
     { return rect.adjusted( 0.5, 0.5, -0.5, -0.5 ).translated( 0.5, 0.5 ); }
 
     //______________________________________________________________________________
-    QPainterPath Helper::roundedPath( const QRectF& rect, Corners corners, qreal radius ) const
+    static QPainterPath createRoundedPath( const QRectF& rect, Corners corners, qreal radius )
     {
 
         QPainterPath path;
@@ -1448,23 +1664,127 @@ namespace Fluent
 
     }
 
-    //________________________________________________________________________________________________________
-    bool Helper::compositingActive() const
+    //______________________________________________________________________________
+    QPainterPath Helper::roundedPath( const QSizeF& size, Corners corners, qreal radius ) const
     {
 
-        #if FLUENT_HAVE_X11
-        if( isX11() )
+        // paths painted into the pixmap caches are built once per pixmap anyway
+        if( !_roundedPathCacheEnabled || _renderingToCache ) return createRoundedPath( QRectF( QPointF( 0, 0 ), size ), corners, radius );
+
+        RoundedPathKey key;
+        key.width = size.width();
+        key.height = size.height();
+        key.corners = corners;
+        key.radius = radius;
+
+        // paths are implicitly shared, returning the cached one does not copy its elements
+        if( const QPainterPath* path = _roundedPaths.object( key ) )
         {
-            // direct call to X
-            xcb_get_selection_owner_cookie_t cookie( xcb_get_selection_owner( connection(), _compositingManagerAtom ) );
-            ScopedPointer<xcb_get_selection_owner_reply_t> reply( xcb_get_selection_owner_reply( connection(), cookie, nullptr ) );
-            return reply && reply->owner;
+            ++_roundedPathCacheStatistics.hits;
+            return *path;
+        }
+
+        ++_roundedPathCacheStatistics.misses;
+        QPainterPath* path( new QPainterPath( createRoundedPath( QRectF( QPointF( 0, 0 ), size ), corners, radius ) ) );
+        _roundedPaths.insert( key, path );
+        return *path;
+
+    }
+
+    //______________________________________________________________________________
+    Helper::PrimitiveKey Helper::primitiveKey(
+        QPainter* painter, Primitive primitive, const QSize& size,
+        const QColor& color, const QColor& outline, const QColor& shadow,
+        int flags, int animation )
+    {
+        PrimitiveKey key;
+        key.primitive = primitive;
+        key.size = size;
+        key.color = color;
+        key.outline = outline;
+        key.shadow = shadow;
+        key.flags = flags;
+        key.animation = animation;
+        key.devicePixelRatio = painterDevicePixelRatio( painter );
+        return key;
+    }
+
+    //______________________________________________________________________________
+    void Helper::renderCached( QPainter* painter, const QRect& rect, const PrimitiveKey& key, const PrimitiveRenderer& render ) const
+    {
 
+        const QSize size( rect.size()*key.devicePixelRatio );
+        const int cost( 4*size.width()*size.height() );
+        if( !( rect.isValid() && cost <= primitiveMaxSize && canBlit( painter, rect, key.devicePixelRatio ) ) )
+        {
+            render( painter, rect );
+            return;
         }
-        #endif
 
-        // use KWindowSystem
-        return KWindowSystem::compositingActive();
+        QPixmap* pixmap( _primitiveCache.object( key ) );
+        if( !pixmap )
+        {
+
+            pixmap = new QPixmap( size );
+            #if QT_VERSION >= 0x050300
+            pixmap->setDevicePixelRatio( key.devicePixelRatio );
+            #endif
+            pixmap->fill( Qt::transparent );
+
+            QPainter localPainter( pixmap );
+            _renderingToCache = true;
+            render( &localPainter, QRect( QPoint(), rect.size() ) );
+            _renderingToCache = false;
+            localPainter.end();
+
+            // cost is below the budget, so the pixmap stays alive
+            _primitiveCache.insert( key, pixmap, cost );
+
+        }
+
+        painter->drawPixmap( rect.topLeft(), *pixmap );
+
+    }
+
+    //______________________________________________________________________________
+    void Helper::renderNinePatch( QPainter* painter, const QRect& rect, const PrimitiveKey& key, const PrimitiveRenderer& render ) const
+    {
+
+        // the source holds the four corners, plus one row and one column that are stretched along the edges
+        const int sourceSize( 2*ninePatchCornerSize + 1 );
+        const qreal dpr( key.devicePixelRatio );
+        if( !( _ninePatchEnabled && rect.width() > sourceSize && rect.height() > sourceSize &&
+            dpr == qRound( dpr ) && canBlit( painter, rect, dpr ) ) )
+        {
+            render( painter, rect );
+            return;
+        }
+
+        TileSet* tileSet( _ninePatchCache.object( key ) );
+        if( !tileSet )
+        {
+
+            QPixmap source( QSize( sourceSize, sourceSize )*dpr );
+            #if QT_VERSION >= 0x050300
+            source.setDevicePixelRatio( dpr );
+            #endif
+            source.fill( Qt::transparent );
+
+            QPainter localPainter( &source );
+            _renderingToCache = true;
+            render( &localPainter, QRect( 0, 0, sourceSize, sourceSize ) );
+            _renderingToCache = false;
+            localPainter.end();
+
+            tileSet = new TileSet( source, ninePatchCornerSize, ninePatchCornerSize, 1, 1 );
+            _ninePatchCache.insert( key, tileSet, 4*source.width()*source.height() );
+
+        }
+
+        // corners and edges from the nine-patch, the center is the plain frame color
+        tileSet->render( rect, painter, TileSet::Ring );
+        if( key.color.isValid() )
+        { painter->fillRect( rect.adjusted( ninePatchCornerSize, ninePatchCornerSize, -ninePatchCornerSize, -ninePatchCornerSize ), key.color ); }
 
     }
 
@@ -1535,16 +1855,14 @@ namespace Fluent
     //____________________________________________________________________
     void Helper::init()
     {
-        #if FLUENT_HAVE_X11
-
-        if( isX11() )
-        {
-            // create compositing screen
-            const QString atomName( QStringLiteral( "_NET_WM_CM_S%1" ).arg( QX11Info::appScreen() ) );
-            _compositingManagerAtom = createAtom( atomName );
-        }
-
-        #endif
+        _primitiveCache.setMaxCost( primitiveCacheSize );
+        _ninePatchCache.setMaxCost( ninePatchCacheSize );
+        _colorTables.setMaxCost( colorTableCount );
+        _roundedPaths.setMaxCost( roundedPathCount );
+        _lastColorTable = nullptr;
+
+        // initial compositing state, the style keeps it up to date
+        _compositingActive = KWindowSystem::compositingActive();
 
     }
 
@@ -23,6 +23,7 @@
 
 #include "fluent.h"
 #include "fluentanimationdata.h"
+#include "fluenttileset.h"
 #include "config-fluent.h"
 
 #include <KColorScheme>
@@ -32,9 +33,15 @@
 #include <KComponentData>
 #endif
 
+#include <QCache>
 #include <QPainterPath>
+#include <QPair>
+#include <QPixmap>
+#include <QVector>
 #include <QWidget>
 
+#include <functional>
+
 #if FLUENT_HAVE_X11
 #include <QX11Info>
 #include <xcb/xcb.h>
@@ -262,8 +269,13 @@ namespace Fluent
         //* true if running on platform Wayland
         static bool isWayland();
 
-        //* returns true if compositing is active
-        bool compositingActive() const;
+        //* returns true if compositing is active. The state is cached, it never queries the windowing system
+        bool compositingActive() const
+        { return _compositingActive; }
+
+        //* update compositing state, when the compositing manager changes
+        void setCompositingActive( bool value )
+        { _compositingActive = value; }
 
         //* returns true if a given widget supports alpha channel
         bool hasAlphaChannel( const QWidget* ) const;
@@ -304,6 +316,37 @@ namespace Fluent
 
         //@}
 
+        //*@name rounded path cache
+        //@{
+
+        //* rounded path cache statistics
+        struct RoundedPathCacheStatistics
+        {
+            quint64 hits = 0;
+            quint64 misses = 0;
+
+            //* fraction of the rounded paths taken from the cache
+            qreal hitRate() const
+            { return hits + misses ? qreal( hits )/( hits + misses ) : 0; }
+        };
+
+        const RoundedPathCacheStatistics& roundedPathCacheStatistics() const
+        { return _roundedPathCacheStatistics; }
+
+        //* reset statistics
+        void resetRoundedPathCacheStatistics()
+        { _roundedPathCacheStatistics = RoundedPathCacheStatistics(); }
+
+        //* enable or disable the rounded path cache, mostly useful for benchmarks and comparisons
+        void setRoundedPathCacheEnabled( bool value )
+        { _roundedPathCacheEnabled = value; }
+
+        //@}
+
+        //* enable or disable the nine-patches of large frames, mostly useful for tests and comparisons
+        void setNinePatchEnabled( bool value )
+        { _ninePatchEnabled = value; }
+
         //* frame radius
         qreal frameRadius( qreal bias = 0 ) const
         { return qMax( qreal( Metrics::Frame_FrameRadius ) - 0.5 + bias, 0.0 ); }
@@ -316,11 +359,230 @@ namespace Fluent
         //* return rectangle for widgets shadow, offset depending on light source
         QRectF shadowRect( const QRectF& ) const;
 
-        //* return rounded path in a given rect, with only selected corners rounded, and for a given radius
-        QPainterPath roundedPath( const QRectF&, Corners, qreal ) const;
+        //* return rounded path of a given size at the origin, with only selected corners rounded, and for a given radius
+        /**
+        Paths are cached for the primitives that are painted directly on every paint,
+        because the painter state does not allow blitting them: fractional device pixel ratios
+        and scaled painters. Primitives painted into the pixmap caches build their path once
+        per pixmap, and do not go through the path cache.
+        */
+        QPainterPath roundedPath( const QSizeF&, Corners, qreal ) const;
 
         private:
 
+        //*@name palette color tables
+        //@{
+
+        //* colors between two colors, one per animation step
+        struct ColorRamp
+        {
+            QColor first;
+            QColor second;
+
+            //* true if the ramp fades the first color out rather than mixing it with the second
+            bool alpha;
+
+            //* one color per animation step, filled on first use
+            mutable QVector<QColor> steps;
+        };
+
+        //* colors that only depend on the palette, and ramps for the animated transitions between them
+        struct ColorTable
+        {
+            enum Ramp
+            {
+                FrameOutlineToFocus,
+                FrameHoverToFocus,
+                FrameOutlineToHover,
+                FocusToHover,
+                ArrowToHover,
+                ArrowToFocus,
+                ButtonToFocus,
+                FocusToButton,
+                ButtonAlpha,
+                ButtonSunkenToFocus,
+                FocusAlpha,
+                ScrollBarHandleToHover,
+                ScrollBarHandleToFocus,
+                RampCount
+            };
+
+            QColor frameOutline;
+            QColor frameHover;
+            QColor frameFocus;
+            QColor arrow;
+            QColor focus;
+            QColor hover;
+            QColor buttonFocusOutline;
+            QColor button;
+            QColor buttonSunken;
+            QColor scrollBarHandle;
+
+            ColorRamp ramps[RampCount];
+        };
+
+        //* color tables are identified by palette and current color group
+        using ColorTableKey = QPair<qint64, int>;
+
+        //* color table for given palette
+        const ColorTable& colorTable( const QPalette& ) const;
+
+        //* ramp between two colors, or fading a color out
+        ColorRamp colorRamp( const QColor& first, const QColor& second, bool alpha = false ) const;
+
+        //* ramp color for given animation opacity. Colors that are not on an animation step are computed directly
+        QColor rampColor( const ColorRamp&, qreal opacity ) const;
+
+        //* color tables, the cost is one per palette
+        mutable QCache<ColorTableKey, ColorTable> _colorTables;
+
+        //* last used color table, most paints in a row share the palette
+        mutable ColorTableKey _lastColorTableKey;
+        mutable const ColorTable* _lastColorTable;
+
+        //@}
+
+        //*@name rounded path cache
+        //@{
+
+        //* what a rounded path at the origin looks like
+        struct RoundedPathKey
+        {
+            qreal width;
+            qreal height;
+            int corners;
+            qreal radius;
+
+            bool operator == ( const RoundedPathKey& other ) const
+            {
+                return width == other.width
+                    && height == other.height
+                    && corners == other.corners
+                    && radius == other.radius;
+            }
+
+            friend uint qHash( const RoundedPathKey& key )
+            {
+                uint hash( key.corners );
+                hash = 31*hash + uint( qRound( 64*key.width ) );
+                hash = 31*hash + uint( qRound( 64*key.height ) );
+                return 31*hash + uint( qRound( 64*key.radius ) );
+            }
+        };
+
+        //* rounded paths of directly painted primitives, built at the origin
+        mutable QCache<RoundedPathKey, QPainterPath> _roundedPaths;
+
+        //* true if the rounded paths are cached
+        bool _roundedPathCacheEnabled = true;
+
+        //* statistics
+        mutable RoundedPathCacheStatistics _roundedPathCacheStatistics;
+
+        //* true while a primitive is painted into the pixmap caches
+        mutable bool _renderingToCache = false;
+
+        //@}
+
+        //*@name primitive render cache
+        //@{
+
+        //* primitives that are rendered through the cache
+        enum Primitive
+        {
+            PrimitiveButtonFrame,
+            PrimitiveToolButtonFrame,
+            PrimitiveCheckBoxBackground,
+            PrimitiveCheckBox,
+            PrimitiveRadioButtonBackground,
+            PrimitiveRadioButton,
+            PrimitiveSliderHandle,
+            PrimitiveTabBarTab,
+            PrimitiveArrow,
+            PrimitiveDecorationButton,
+            PrimitiveFrame,
+            PrimitiveMenuFrame,
+            PrimitiveTabWidgetFrame
+        };
+
+        //* everything a cached primitive looks like depends on
+        struct PrimitiveKey
+        {
+            Primitive primitive;
+            QSize size;
+            QColor color;
+            QColor outline;
+            QColor shadow;
+
+            //* primitive specific state: sunken, focus, check state, corners, ...
+            int flags;
+
+            //* animation progress, quantized
+            int animation;
+
+            qreal devicePixelRatio;
+
+            bool operator == ( const PrimitiveKey& other ) const
+            {
+                return primitive == other.primitive
+                    && size == other.size
+                    && color == other.color
+                    && outline == other.outline
+                    && shadow == other.shadow
+                    && flags == other.flags
+                    && animation == other.animation
+                    && devicePixelRatio == other.devicePixelRatio;
+            }
+
+            friend uint qHash( const PrimitiveKey& key )
+            {
+                uint hash( key.primitive );
+                hash = 31*hash + key.size.width();
+                hash = 31*hash + key.size.height();
+                hash = 31*hash + key.color.rgba();
+                hash = 31*hash + key.outline.rgba();
+                hash = 31*hash + key.shadow.rgba();
+                hash = 31*hash + key.flags;
+                hash = 31*hash + key.animation;
+                return 31*hash + uint( 100*key.devicePixelRatio );
+            }
+        };
+
+        //* paints a primitive in given rect
+        using PrimitiveRenderer = std::function<void( QPainter*, const QRect& )>;
+
+        //* primitive key, the device pixel ratio is taken from the painter
+        static PrimitiveKey primitiveKey( QPainter*, Primitive, const QSize&, const QColor& color, const QColor& outline = QColor(), const QColor& shadow = QColor(), int flags = 0, int animation = 0 );
+
+        //* blit primitive from the cache, painting and storing it first if needed. Falls back to painting directly when the painter state does not allow blitting
+        void renderCached( QPainter*, const QRect&, const PrimitiveKey&, const PrimitiveRenderer& ) const;
+
+        //* paint a large frame from a nine-patch, whose corners are painted once per key and whose center is filled with the key color. Falls back to painting directly when the painter state or the rect size does not allow it
+        /**
+        Single layer frames, a fill or an outline, give the same pixels as painting directly.
+        Where the outline overlaps the antialiased fill, blending both into the transparent source
+        before blending it over the destination rounds differently, by up to 2 per channel
+        */
+        void renderNinePatch( QPainter*, const QRect&, const PrimitiveKey&, const PrimitiveRenderer& ) const;
+
+        //* number of steps animations are quantized to, in the cache key
+        enum { AnimationSteps = 32 };
+
+        //* quantized animation progress
+        static int quantizedAnimation( qreal value )
+        { return qRound( qBound( qreal( 0 ), value, qreal( 1 ) )*AnimationSteps ); }
+
+        //* cached primitives, least recently used are dropped first. The cost is in bytes
+        mutable QCache<PrimitiveKey, QPixmap> _primitiveCache;
+
+        //* nine-patches of large frames, they do not depend on the frame size. The cost is in bytes
+        mutable QCache<PrimitiveKey, TileSet> _ninePatchCache;
+
+        //* true if large frames are painted from nine-patches
+        bool _ninePatchEnabled = true;
+
+        //@}
+
         #if FLUENT_USE_KDE4
         //* component data
         KComponentData _componentData;
@@ -344,12 +606,8 @@ namespace Fluent
         QColor _inactiveTitleBarTextColor;
         //@}
 
-        #if FLUENT_HAVE_X11
-
-        //* atom used for compositing manager
-        xcb_atom_t _compositingManagerAtom;
-
-        #endif
+        //* compositing state
+        bool _compositingActive;
 
     };
 
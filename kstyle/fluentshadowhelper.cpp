@@ -24,11 +24,13 @@
 #include "fluentboxshadowrenderer.h"
 #include "fluenthelper.h"
 #include "fluentpropertynames.h"
+#include "fluentshadowcache.h"
 #include "fluentstyleconfigdata.h"
 
 #include <QDockWidget>
 #include <QEvent>
 #include <QApplication>
+#include <QCache>
 #include <QMenu>
 #include <QPainter>
 #include <QPixmap>
@@ -48,64 +50,25 @@
 #include <KWayland/Client/surface.h>
 #endif
 
-namespace
-{
-    using Fluent::CompositeShadowParams;
-    using Fluent::ShadowParams;
-
-    const CompositeShadowParams s_shadowParams[] = {
-        // None
-        CompositeShadowParams(),
-        // Small
-        CompositeShadowParams(
-            QPoint(0, 3),
-            ShadowParams(QPoint(0, 0), 12, 0.26),
-            ShadowParams(QPoint(0, -2), 6, 0.16)),
-        // Medium
-        CompositeShadowParams(
-            QPoint(0, 4),
-            ShadowParams(QPoint(0, 0), 16, 0.24),
-            ShadowParams(QPoint(0, -2), 8, 0.14)),
-        // Large
-        CompositeShadowParams(
-            QPoint(0, 5),
-            ShadowParams(QPoint(0, 0), 20, 0.22),
-            ShadowParams(QPoint(0, -3), 10, 0.12)),
-        // Very Large
-        CompositeShadowParams(
-            QPoint(0, 6),
-            ShadowParams(QPoint(0, 0), 24, 0.2),
-            ShadowParams(QPoint(0, -3), 12, 0.1))
-    };
-}
-
 namespace Fluent
 {
 
     const char ShadowHelper::netWMShadowAtomName[] ="_KDE_NET_WM_SHADOW";
 
-    //_____________________________________________________
-    CompositeShadowParams ShadowHelper::lookupShadowParams(int shadowSizeEnum)
-    {
-
-        switch (shadowSizeEnum) {
-        case StyleConfigData::ShadowNone:
-            return s_shadowParams[0];
-        case StyleConfigData::ShadowSmall:
-            return s_shadowParams[1];
-        case StyleConfigData::ShadowMedium:
-            return s_shadowParams[2];
-        case StyleConfigData::ShadowLarge:
-            return s_shadowParams[3];
-        case StyleConfigData::ShadowVeryLarge:
-            return s_shadowParams[4];
-        default:
-            // Fallback to the Large size.
-            return s_shadowParams[3];
-        }
+    //* byte budget of the masked shadow tiles
+    static const int maskedShadowTilesCacheSize = 4*1024*1024;
 
+    //* shadow tiles with the frame masked out, keyed by the shadow and the frame radius, shared by every shadow helper
+    static QCache<QByteArray, QVector<QImage> >& maskedShadowTiles()
+    {
+        static QCache<QByteArray, QVector<QImage> > cache( maskedShadowTilesCacheSize );
+        return cache;
     }
 
+    //_____________________________________________________
+    CompositeShadowParams ShadowHelper::lookupShadowParams(int shadowSizeEnum)
+    { return Fluent::lookupShadowParams(s_styleShadowParams, shadowSizeEnum); }
+
     //_____________________________________________________
     ShadowHelper::ShadowHelper( QObject* parent, Helper& helper ):
         QObject( parent ),
@@ -167,6 +130,7 @@ namespace Fluent
 
         _pixmaps.clear();
         _shadowTiles = TileSet();
+        _shadowImages.clear();
 
     }
 
@@ -302,44 +266,72 @@ namespace Fluent
         shadowRenderer.addShadow(params.shadow2.offset, params.shadow2.radius,
             withOpacity(color, params.shadow2.opacity * strength));
 
-        QImage shadowTexture = shadowRenderer.render();
-
-        const QRect outerRect(QPoint(0, 0), shadowTexture.size() / dpr);
+        const QRect outerRect(QPoint(0, 0), shadowRenderer.textureSize());
 
         QRect boxRect(QPoint(0, 0), boxSize);
         boxRect.moveCenter(outerRect.center());
 
-        // Mask out inner rect.
-        QPainter painter(&shadowTexture);
-        painter.setRenderHint(QPainter::Antialiasing);
-
         const QMargins margins = QMargins(
             boxRect.left() - outerRect.left() - Metrics::Shadow_Overlap - params.offset.x(),
             boxRect.top() - outerRect.top() - Metrics::Shadow_Overlap - params.offset.y(),
             outerRect.right() - boxRect.right() - Metrics::Shadow_Overlap + params.offset.x(),
             outerRect.bottom() - boxRect.bottom() - Metrics::Shadow_Overlap + params.offset.y());
 
-        painter.setPen(Qt::NoPen);
-        painter.setBrush(Qt::black);
-        painter.setCompositionMode(QPainter::CompositionMode_DestinationOut);
-        painter.drawRoundedRect(
 #if FLUENT_USE_KDE4
-            outerRect.adjusted(margins.left(), margins.top(), -margins.right(), -margins.bottom()),
+        const QRect innerRect = outerRect.adjusted(margins.left(), margins.top(), -margins.right(), -margins.bottom());
 #else
-            outerRect - margins,
+        const QRect innerRect = outerRect - margins;
 #endif
-            frameRadius,
-            frameRadius);
-
-        // We're done.
-        painter.end();
 
+        // Mask out inner rect.
         const QPoint innerRectTopLeft = outerRect.center();
+        const int columns[] = { 0, innerRectTopLeft.x(), innerRectTopLeft.x() + 1 };
+        const int rows[] = { 0, innerRectTopLeft.y(), innerRectTopLeft.y() + 1 };
+
+        // the masked tiles are kept, so that reloading the configuration does not mask them again
+        const QByteArray key( shadowRenderer.cacheKey() + QByteArray::number( frameRadius ) );
+        if( const QVector<QImage>* images = maskedShadowTiles().object( key ) )
+        {
+
+            _shadowImages = *images;
+
+        } else {
+
+            // Render the tiles directly, the compositor and the tileset only need
+            // those, never the whole texture. Masking them detaches them from the
+            // shadow cache.
+            _shadowImages = ShadowCache::self()->tiles(shadowRenderer);
+
+            int cost = 0;
+            for( int i = 0; i < _shadowImages.size(); ++i )
+            {
+                QPainter painter(&_shadowImages[i]);
+                painter.setRenderHint(QPainter::Antialiasing);
+                painter.translate(-columns[i % 3], -rows[i / 3]);
+                painter.setPen(Qt::NoPen);
+                painter.setBrush(Qt::black);
+                painter.setCompositionMode(QPainter::CompositionMode_DestinationOut);
+                painter.drawRoundedRect(innerRect, frameRadius, frameRadius);
+                painter.end();
+
+                cost += _shadowImages.at(i).byteCount();
+            }
+
+            maskedShadowTiles().insert( key, new QVector<QImage>( _shadowImages ), cost );
+
+        }
+
+        QVector<QPixmap> pixmaps;
+        pixmaps.reserve( _shadowImages.size() );
+        for( int i = 0; i < _shadowImages.size(); ++i )
+        { pixmaps.append( QPixmap::fromImage( _shadowImages.at(i) ) ); }
+
         _shadowTiles = TileSet(
-            QPixmap::fromImage(shadowTexture),
+            pixmaps,
             innerRectTopLeft.x(),
             innerRectTopLeft.y(),
-            1, 1);
+            outerRect.width() - innerRectTopLeft.x() - 1,
+            outerRect.height() - innerRectTopLeft.y() - 1);
 
         return _shadowTiles;
     }
@@ -409,14 +401,14 @@ namespace Fluent
         if( _pixmaps.empty() )
         {
             _pixmaps = QVector<quint32> {
-                createPixmap( _shadowTiles.pixmap( 1 ) ),
-                createPixmap( _shadowTiles.pixmap( 2 ) ),
-                createPixmap( _shadowTiles.pixmap( 5 ) ),
-                createPixmap( _shadowTiles.pixmap( 8 ) ),
-                createPixmap( _shadowTiles.pixmap( 7 ) ),
-                createPixmap( _shadowTiles.pixmap( 6 ) ),
-                createPixmap( _shadowTiles.pixmap( 3 ) ),
-                createPixmap( _shadowTiles.pixmap( 0 ) )
+                createPixmap( _shadowImages.at( 1 ) ),
+                createPixmap( _shadowImages.at( 2 ) ),
+                createPixmap( _shadowImages.at( 5 ) ),
+                createPixmap( _shadowImages.at( 8 ) ),
+                createPixmap( _shadowImages.at( 7 ) ),
+                createPixmap( _shadowImages.at( 6 ) ),
+                createPixmap( _shadowImages.at( 3 ) ),
+                createPixmap( _shadowImages.at( 0 ) )
             };
         }
 
@@ -426,17 +418,16 @@ namespace Fluent
     }
 
     //______________________________________________
-    quint32 ShadowHelper::createPixmap( const QPixmap& source )
+    quint32 ShadowHelper::createPixmap( const QImage& source )
     {
 
-        // do nothing for invalid pixmaps
+        // do nothing for invalid images
         if( source.isNull() ) return 0;
         if( !Helper::isX11() ) return 0;
 
         /*
-        in some cases, pixmap handle is invalid. This is the case notably
-        when Qt uses to RasterEngine. In this case, we create an X11 Pixmap
-        explicitly and draw the source pixmap on it.
+        we create an X11 Pixmap explicitly and upload the source image to it,
+        the tiles are rendered as images so there is no pixmap handle to reuse.
         */
 
         #if FLUENT_HAVE_X11
@@ -455,9 +446,8 @@ namespace Fluent
             xcb_create_gc( Helper::connection(), _gc, pixmap, 0, nullptr );
         }
 
-        // create image from QPixmap and assign to pixmap
-        QImage image( source.toImage() );
-        xcb_put_image( Helper::connection(), XCB_IMAGE_FORMAT_Z_PIXMAP, pixmap, _gc, image.width(), image.height(), 0, 0, 0, 32, image.byteCount(), image.constBits());
+        // assign image to pixmap
+        xcb_put_image( Helper::connection(), XCB_IMAGE_FORMAT_Z_PIXMAP, pixmap, _gc, source.width(), source.height(), 0, 0, 0, 32, source.byteCount(), source.constBits());
 
         return pixmap;
 
@@ -536,14 +526,14 @@ namespace Fluent
         if( !shadow->isValid() ) return false;
 
         // add the shadow elements
-        shadow->attachTop( _shmPool->createBuffer( _shadowTiles.pixmap( 1 ).toImage() ) );
-        shadow->attachTopRight( _shmPool->createBuffer( _shadowTiles.pixmap( 2 ).toImage() ) );
-        shadow->attachRight( _shmPool->createBuffer( _shadowTiles.pixmap( 5 ).toImage() ) );
-        shadow->attachBottomRight( _shmPool->createBuffer( _shadowTiles.pixmap( 8 ).toImage() ) );
-        shadow->attachBottom( _shmPool->createBuffer( _shadowTiles.pixmap( 7 ).toImage() ) );
-        shadow->attachBottomLeft( _shmPool->createBuffer( _shadowTiles.pixmap( 6 ).toImage() ) );
-        shadow->attachLeft( _shmPool->createBuffer( _shadowTiles.pixmap( 3 ).toImage() ) );
-        shadow->attachTopLeft( _shmPool->createBuffer( _shadowTiles.pixmap( 0 ).toImage() ) );
+        shadow->attachTop( _shmPool->createBuffer( _shadowImages.at( 1 ) ) );
+        shadow->attachTopRight( _shmPool->createBuffer( _shadowImages.at( 2 ) ) );
+        shadow->attachRight( _shmPool->createBuffer( _shadowImages.at( 5 ) ) );
+        shadow->attachBottomRight( _shmPool->createBuffer( _shadowImages.at( 8 ) ) );
+        shadow->attachBottom( _shmPool->createBuffer( _shadowImages.at( 7 ) ) );
+        shadow->attachBottomLeft( _shmPool->createBuffer( _shadowImages.at( 6 ) ) );
+        shadow->attachLeft( _shmPool->createBuffer( _shadowImages.at( 3 ) ) );
+        shadow->attachTopLeft( _shmPool->createBuffer( _shadowImages.at( 0 ) ) );
 
         shadow->setOffsets( shadowMargins( widget ) );
         shadow->commit();
@@ -20,9 +20,11 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA .        *
  *************************************************************************/
 
+#include "fluentshadowparams.h"
 #include "fluenttileset.h"
 #include "config-fluent.h"
 
+#include <QImage>
 #include <QObject>
 #include <QPointer>
 #include <QMap>
@@ -50,41 +52,6 @@ namespace Fluent
     //* forward declaration
     class Helper;
 
-    struct ShadowParams
-    {
-        ShadowParams() = default;
-
-        ShadowParams(const QPoint &offset, int radius, qreal opacity):
-            offset(offset),
-            radius(radius),
-            opacity(opacity)
-        {}
-
-        QPoint offset;
-        int radius = 0;
-        qreal opacity = 0;
-    };
-
-    struct CompositeShadowParams
-    {
-        CompositeShadowParams() = default;
-
-        CompositeShadowParams(
-                const QPoint &offset,
-                const ShadowParams &shadow1,
-                const ShadowParams &shadow2)
-            : offset(offset)
-            , shadow1(shadow1)
-            , shadow2(shadow2) {}
-
-        bool isNone() const
-        { return qMax(shadow1.radius, shadow2.radius) == 0; }
-
-        QPoint offset;
-        ShadowParams shadow1;
-        ShadowParams shadow2;
-    };
-
     //* handle shadow pixmaps passed to window manager via X property
     class ShadowHelper: public QObject
     {
@@ -154,8 +121,8 @@ namespace Fluent
         // create pixmap handles from tileset
         const QVector<quint32>& createPixmapHandles();
 
-        // create pixmap handle from pixmap
-        quint32 createPixmap( const QPixmap& );
+        // create pixmap handle from image
+        quint32 createPixmap( const QImage& );
 
         //* installs shadow on given widget in a platform independent way
         bool installShadows( QWidget * );
@@ -193,6 +160,9 @@ namespace Fluent
         //* tileset
         TileSet _shadowTiles;
 
+        //* shadow tiles, as rendered, passed to the compositor
+        QVector<QImage> _shadowImages;
+
         //* number of pixmaps
         enum { numPixmaps = 8 };
 
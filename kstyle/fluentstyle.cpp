@@ -33,6 +33,7 @@
 #include "fluentblurhelper.h"
 
 #include <KColorUtils>
+#include <KWindowSystem>
 
 #include <QApplication>
 #include <QCheckBox>
@@ -201,6 +202,12 @@ namespace Fluent
         connect(qApp, &QApplication::paletteChanged, this, &Style::configurationChanged);
         #endif
         #endif
+
+        // track the compositing manager, so that painting never has to ask the windowing system.
+        // KWindowSystem watches the manager selection with XFixes on X11, once connected the query below is answered from its cache
+        connect( KWindowSystem::self(), SIGNAL(compositingChanged(bool)), this, SLOT(compositingChanged(bool)) );
+        _helper->setCompositingActive( KWindowSystem::compositingActive() );
+
         // call the slot directly; this initial call will set up things that also
         // need to be reset when the system palette changes
         loadConfiguration();
@@ -1413,6 +1420,10 @@ namespace Fluent
 
     }
 
+    //_____________________________________________________________________
+    void Style::compositingChanged( bool active )
+    { _helper->setCompositingActive( active ); }
+
     //_____________________________________________________________________
     void Style::loadConfiguration()
     {
@@ -96,6 +96,10 @@ namespace Fluent
         //* destructor
         ~Style() override;
 
+        //* helper, mostly useful for benchmarks and tests
+        Helper& helper() const
+        { return *_helper; }
+
         //* needed to avoid warnings at compilation time
         using  ParentStyleClass::polish;
         using  ParentStyleClass::unpolish;
@@ -168,6 +172,9 @@ namespace Fluent
         //* update configuration
         void configurationChanged();
 
+        //* update compositing state
+        void compositingChanged( bool );
+
         //* standard icons
         QIcon standardIconImplementation( StandardPixmap, const QStyleOption*, const QWidget* ) const;
 
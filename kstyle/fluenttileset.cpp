@@ -119,6 +119,16 @@ namespace Fluent
         initPixmap( _pixmaps, source, _w3, _h3, QRect(_w1+w2, _h1+h2, _w3, _h3) );
     }
 
+    //______________________________________________________________
+    TileSet::TileSet(const QVector<QPixmap> &pixmaps, int w1, int h1, int w3, int h3 ):
+        _w1(w1),
+        _h1(h1),
+        _w3(w3),
+        _h3(h3)
+    {
+        if( pixmaps.size() == 9 ) _pixmaps = pixmaps;
+    }
+
     //___________________________________________________________
     void TileSet::render(const QRect &constRect, QPainter *painter, Tiles tiles) const
     {
@@ -47,6 +47,17 @@ namespace Fluent
         */
         TileSet(const QPixmap&, int w1, int h1, int w2, int h2 );
 
+        /**
+        Create a TileSet from nine already split pixmaps, ordered from top-left
+        to bottom-right. The center chunks are taken from the pixmaps.
+
+        @param w1 width of the left chunks
+        @param h1 height of the top chunks
+        @param w3 width of the right chunks
+        @param h3 height of the bottom chunks
+        */
+        TileSet(const QVector<QPixmap>&, int w1, int h1, int w3, int h3 );
+
         //* empty constructor
         TileSet();
 
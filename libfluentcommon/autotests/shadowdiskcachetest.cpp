@@ -0,0 +1,246 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// own
+#include "fluentshadowdiskcache.h"
+
+// Qt
+#include <QFile>
+#include <QFileInfo>
+#include <QScopedPointer>
+#include <QTemporaryDir>
+#include <QTest>
+
+using namespace Fluent;
+
+class ShadowDiskCacheTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+
+    void testInsertIsKeptInMemory();
+    void testPendingImagesAreBounded();
+    void testRoundTrip();
+    void testFoundImagesOutliveTheMapping();
+    void testCorruptedEntry();
+    void testCorruptedIndex();
+    void testMergeWithOtherWriters();
+
+private:
+    QString fileName() const;
+    void flipByte(qint64 offset) const;
+
+    QScopedPointer<QTemporaryDir> m_directory;
+};
+
+// A small image, different for every seed.
+static QImage testImage(int seed)
+{
+    QImage image(37, 21, QImage::Format_ARGB32_Premultiplied);
+    image.fill(qRgba(seed, 2 * seed, 3 * seed, 255));
+    image.setPixel(seed % image.width(), seed % image.height(), qRgba(0, 0, 0, 0));
+    image.setDevicePixelRatio(1.5);
+    return image;
+}
+
+static void compareImages(const QVector<QImage> &actual, const QVector<QImage> &expected)
+{
+    QCOMPARE(actual.size(), expected.size());
+    for (int i = 0; i < actual.size(); ++i) {
+        QCOMPARE(actual.at(i), expected.at(i));
+        QCOMPARE(actual.at(i).devicePixelRatio(), expected.at(i).devicePixelRatio());
+    }
+}
+
+void ShadowDiskCacheTest::init()
+{
+    m_directory.reset(new QTemporaryDir);
+    QVERIFY(m_directory->isValid());
+}
+
+void ShadowDiskCacheTest::cleanup()
+{
+    m_directory.reset();
+}
+
+QString ShadowDiskCacheTest::fileName() const
+{
+    return m_directory->path() + QLatin1String("/shadows.cache");
+}
+
+void ShadowDiskCacheTest::flipByte(qint64 offset) const
+{
+    QFile file(fileName());
+    QVERIFY(file.open(QIODevice::ReadWrite));
+
+    QByteArray contents = file.readAll();
+    QVERIFY(offset >= 0 && offset < contents.size());
+    contents[int(offset)] = contents.at(int(offset)) ^ 0xff;
+
+    QVERIFY(file.seek(0));
+    QCOMPARE(file.write(contents), qint64(contents.size()));
+}
+
+void ShadowDiskCacheTest::testInsertIsKeptInMemory()
+{
+    const QVector<QImage> images = QVector<QImage>() << testImage(1) << testImage(2);
+
+    ShadowDiskCache cache(fileName());
+    QVERIFY(!cache.isDirty());
+
+    cache.insert("key", images);
+    QVERIFY(cache.isDirty());
+    QVERIFY(cache.contains("key"));
+    compareImages(cache.find("key"), images);
+    QVERIFY(!QFile::exists(fileName()));
+
+    QVERIFY(cache.flush());
+    QVERIFY(!cache.isDirty());
+    QVERIFY(QFile::exists(fileName()));
+}
+
+void ShadowDiskCacheTest::testPendingImagesAreBounded()
+{
+    // 4 MB each, five of them do not fit in the 16 MiB of the file.
+    QImage image(1000, 1000, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::black);
+
+    ShadowDiskCache cache(fileName());
+    for (int i = 0; i < 5; ++i) {
+        cache.insert(QByteArray::number(i), QVector<QImage>() << image);
+    }
+
+    // The oldest image is dropped, the others are still pending.
+    QVERIFY(!cache.contains("0"));
+    for (int i = 1; i < 5; ++i) {
+        QVERIFY(cache.contains(QByteArray::number(i)));
+    }
+
+    // An image larger than the file is never kept.
+    QImage large(4096, 1025, QImage::Format_ARGB32_Premultiplied);
+    large.fill(Qt::black);
+    cache.insert("large", QVector<QImage>() << large);
+    QVERIFY(!cache.contains("large"));
+    QVERIFY(cache.contains("4"));
+}
+
+void ShadowDiskCacheTest::testRoundTrip()
+{
+    const QVector<QImage> images = QVector<QImage>() << testImage(1) << testImage(2);
+
+    {
+        ShadowDiskCache cache(fileName());
+        cache.insert("key", images);
+        QVERIFY(cache.flush());
+    }
+
+    ShadowDiskCache cache(fileName());
+    QVERIFY(cache.contains("key"));
+    QVERIFY(!cache.contains("other"));
+    compareImages(cache.find("key"), images);
+    QVERIFY(cache.find("other").isEmpty());
+}
+
+void ShadowDiskCacheTest::testFoundImagesOutliveTheMapping()
+{
+    const QVector<QImage> images = QVector<QImage>() << testImage(3);
+
+    ShadowDiskCache cache(fileName());
+    cache.insert("first", images);
+    QVERIFY(cache.flush());
+
+    // Drop the pending images, find() has to read the mapping.
+    ShadowDiskCache reopened(fileName());
+    const QVector<QImage> found = reopened.find("first");
+
+    // Replacing the file unmaps the mapping the images were read from.
+    reopened.insert("second", QVector<QImage>() << testImage(4));
+    QVERIFY(reopened.flush());
+
+    compareImages(found, images);
+}
+
+void ShadowDiskCacheTest::testCorruptedEntry()
+{
+    {
+        ShadowDiskCache cache(fileName());
+        cache.insert("corrupted", QVector<QImage>() << testImage(5));
+        QVERIFY(cache.flush());
+    }
+
+    // The last byte of the file belongs to the pixels of the only entry.
+    flipByte(QFileInfo(fileName()).size() - 1);
+
+    ShadowDiskCache cache(fileName());
+
+    // Entries are only verified when they are used.
+    QVERIFY(cache.contains("corrupted"));
+    QVERIFY(cache.find("corrupted").isEmpty());
+    QVERIFY(!cache.contains("corrupted"));
+
+    // The next write drops the corrupted entry.
+    const QVector<QImage> images = QVector<QImage>() << testImage(6);
+    cache.insert("valid", images);
+    QVERIFY(cache.flush());
+
+    ShadowDiskCache reopened(fileName());
+    QVERIFY(!reopened.contains("corrupted"));
+    compareImages(reopened.find("valid"), images);
+}
+
+void ShadowDiskCacheTest::testCorruptedIndex()
+{
+    {
+        ShadowDiskCache cache(fileName());
+        cache.insert("key", QVector<QImage>() << testImage(7));
+        QVERIFY(cache.flush());
+    }
+
+    // The index follows the 32 bytes of the file header.
+    flipByte(32);
+
+    // A file with a broken index is ignored as a whole.
+    ShadowDiskCache cache(fileName());
+    QVERIFY(!cache.contains("key"));
+    QVERIFY(cache.find("key").isEmpty());
+}
+
+void ShadowDiskCacheTest::testMergeWithOtherWriters()
+{
+    const QVector<QImage> firstImages = QVector<QImage>() << testImage(8);
+    const QVector<QImage> secondImages = QVector<QImage>() << testImage(9);
+
+    // Both caches are opened before either writes, as in two processes.
+    ShadowDiskCache first(fileName());
+    ShadowDiskCache second(fileName());
+
+    first.insert("first", firstImages);
+    QVERIFY(first.flush());
+
+    second.insert("second", secondImages);
+    QVERIFY(second.flush());
+
+    ShadowDiskCache reopened(fileName());
+    compareImages(reopened.find("first"), firstImages);
+    compareImages(reopened.find("second"), secondImages);
+}
+
+QTEST_GUILESS_MAIN(ShadowDiskCacheTest)
+
+#include "shadowdiskcachetest.moc"
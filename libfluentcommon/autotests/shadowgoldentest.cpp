@@ -0,0 +1,123 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// own
+#include "fluentboxblur.h"
+#include "fluentshadowgolden.h"
+#include "fluentshadowpresets.h"
+
+// Qt
+#include <QTest>
+
+using namespace Fluent;
+
+Q_DECLARE_METATYPE(Fluent::BoxBlur::Kernel)
+
+class ShadowGoldenTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanup();
+
+    void testGoldenChecksums_data();
+    void testGoldenChecksums();
+
+private:
+    BoxBlur::Kernel m_kernel = BoxBlur::ScalarKernel;
+    bool m_specialized = true;
+};
+
+static const ShadowPreset *findPreset(const char *name)
+{
+    for (const ShadowPreset &preset : s_shadowPresets) {
+        if (qstrcmp(preset.name, name) == 0) {
+            return &preset;
+        }
+    }
+    return nullptr;
+}
+
+void ShadowGoldenTest::initTestCase()
+{
+    m_kernel = BoxBlur::kernel();
+    m_specialized = BoxBlur::specializedKernelsEnabled();
+}
+
+void ShadowGoldenTest::cleanup()
+{
+    BoxBlur::setKernel(m_kernel);
+    BoxBlur::setSpecializedKernelsEnabled(m_specialized);
+}
+
+void ShadowGoldenTest::testGoldenChecksums_data()
+{
+    QTest::addColumn<BoxBlur::Kernel>("kernel");
+    QTest::addColumn<bool>("specialized");
+    QTest::addColumn<QByteArray>("preset");
+    QTest::addColumn<qreal>("dpr");
+    QTest::addColumn<int>("layer");
+    QTest::addColumn<quint64>("checksum");
+
+    const struct {
+        BoxBlur::Kernel kernel;
+        const char *name;
+    } kernels[] = {
+        { BoxBlur::ScalarKernel, "scalar" },
+        { BoxBlur::Sse2Kernel, "sse2" },
+        { BoxBlur::Avx2Kernel, "avx2" },
+    };
+
+    for (const auto &kernel : kernels) {
+        for (const bool specialized : { false, true }) {
+            for (const GoldenChecksum &golden : s_goldenChecksums) {
+                const QByteArray name = QByteArray(kernel.name)
+                    + (specialized ? "/specialized/" : "/generic/")
+                    + golden.preset + "@" + QByteArray::number(golden.dpr) + "/" + QByteArray::number(golden.layer);
+                QTest::newRow(name.constData()) << kernel.kernel << specialized << QByteArray(golden.preset)
+                    << golden.dpr << golden.layer << golden.checksum;
+            }
+        }
+    }
+}
+
+void ShadowGoldenTest::testGoldenChecksums()
+{
+    QFETCH(BoxBlur::Kernel, kernel);
+    QFETCH(bool, specialized);
+    QFETCH(QByteArray, preset);
+    QFETCH(qreal, dpr);
+    QFETCH(int, layer);
+    QFETCH(quint64, checksum);
+
+    if (!BoxBlur::isKernelSupported(kernel)) {
+        QSKIP("the kernel is not supported by this CPU");
+    }
+
+    BoxBlur::setKernel(kernel);
+    BoxBlur::setSpecializedKernelsEnabled(specialized);
+    QCOMPARE(BoxBlur::kernel(), kernel);
+
+    const ShadowPreset *shadowPreset = findPreset(preset.constData());
+    QVERIFY(shadowPreset);
+
+    QCOMPARE(alphaChecksum(goldenMask(*shadowPreset, dpr, layer)), checksum);
+}
+
+QTEST_GUILESS_MAIN(ShadowGoldenTest)
+
+#include "shadowgoldentest.moc"
@@ -0,0 +1,157 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#pragma once
+
+/*
+ * Helpers shared by the benchmarks: heap allocation counting and the
+ * statistics of a series of measurements.
+ *
+ * The allocation counter interposes malloc, so this header must be
+ * included by exactly one source file of a benchmark executable.
+ */
+
+// Qt
+#include <QJsonObject>
+#include <QVector>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+
+// heap allocations are counted by interposing malloc, which is only possible with glibc
+#if defined(__GLIBC__)
+#define FLUENT_COUNT_ALLOCATIONS 1
+
+#include <malloc.h>
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *pointer, size_t size);
+
+// large blurs allocate from the thread pool too
+static std::atomic<bool> s_countAllocations(false);
+static std::atomic<qint64> s_allocations(0);
+static std::atomic<qint64> s_allocatedBytes(0);
+
+extern "C" void *malloc(size_t size)
+{
+    if (s_countAllocations) {
+        ++s_allocations;
+        s_allocatedBytes += size;
+    }
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+    if (s_countAllocations) {
+        ++s_allocations;
+        s_allocatedBytes += count * size;
+    }
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *pointer, size_t size)
+{
+    if (s_countAllocations) {
+        ++s_allocations;
+        s_allocatedBytes += size;
+    }
+    return __libc_realloc(pointer, size);
+}
+#else
+#define FLUENT_COUNT_ALLOCATIONS 0
+#endif
+
+namespace Fluent
+{
+
+// heap memory in use, -1 if it is not known
+inline qint64 heapInUse()
+{
+#if !FLUENT_COUNT_ALLOCATIONS
+    return -1;
+#elif __GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33)
+    return qint64(mallinfo2().uordblks);
+#else
+    return qint64(mallinfo().uordblks);
+#endif
+}
+
+// Allocations made between start() and stop(), summed over every start()
+// and stop() pair.
+class AllocationCounter
+{
+public:
+    void start()
+    {
+#if FLUENT_COUNT_ALLOCATIONS
+        const qint64 allocations = s_allocations;
+        const qint64 bytes = s_allocatedBytes;
+        m_allocations -= allocations;
+        m_bytes -= bytes;
+        s_countAllocations = true;
+#endif
+    }
+
+    void stop()
+    {
+#if FLUENT_COUNT_ALLOCATIONS
+        s_countAllocations = false;
+        m_allocations += s_allocations;
+        m_bytes += s_allocatedBytes;
+#endif
+    }
+
+    qint64 allocations() const
+    {
+        return m_allocations;
+    }
+
+    qint64 bytes() const
+    {
+        return m_bytes;
+    }
+
+private:
+    qint64 m_allocations = 0;
+    qint64 m_bytes = 0;
+};
+
+// The mean, median, 95th percentile and maximum of the values.
+inline QJsonObject distribution(QVector<qreal> values)
+{
+    QJsonObject result;
+    if (values.isEmpty()) {
+        return result;
+    }
+
+    std::sort(values.begin(), values.end());
+
+    qreal sum = 0;
+    for (const qreal value : values) {
+        sum += value;
+    }
+
+    result[QStringLiteral("mean")] = sum / values.size();
+    result[QStringLiteral("median")] = values.at(values.size() / 2);
+    result[QStringLiteral("p95")] = values.at(qMin(values.size() - 1, int(values.size() * 0.95)));
+    result[QStringLiteral("max")] = values.last();
+    return result;
+}
+
+} // namespace Fluent
@@ -0,0 +1,111 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Compare the blur kernels compiled for the preset box sizes with the
+ * generic ones.
+ *
+ * For every shadow preset, device pixel ratio and supported instruction
+ * set, the shadow texture is rendered with the generic and with the
+ * specialized kernels. The harness checks that both render the same pixels
+ * and prints the time each takes.
+ */
+
+// own
+#include "fluentboxblur.h"
+#include "fluentboxshadowrenderer.h"
+#include "fluentshadowpresets.h"
+
+// Qt
+#include <QElapsedTimer>
+#include <QGuiApplication>
+#include <QTextStream>
+
+using namespace Fluent;
+
+static QImage renderPreset(const ShadowPreset &preset, qreal dpr, bool specialized)
+{
+    BoxBlur::setSpecializedKernelsEnabled(specialized);
+
+    BoxShadowRenderer renderer;
+    preset.setup(renderer, dpr);
+    return renderer.render();
+}
+
+static qreal timePreset(const ShadowPreset &preset, qreal dpr, bool specialized)
+{
+    // Run for at least 200ms, and at least 5 times, and report the average.
+    QElapsedTimer timer;
+    timer.start();
+
+    int iterations = 0;
+    do {
+        renderPreset(preset, dpr, specialized);
+        ++iterations;
+    } while (iterations < 5 || timer.elapsed() < 200);
+
+    return timer.nsecsElapsed() / 1e6 / iterations;
+}
+
+int main(int argc, char **argv)
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication app(argc, argv);
+
+    const struct {
+        BoxBlur::Kernel kernel;
+        const char *name;
+    } kernels[] = {
+        { BoxBlur::ScalarKernel, "scalar" },
+        { BoxBlur::Sse2Kernel, "sse2" },
+        { BoxBlur::Avx2Kernel, "avx2" }
+    };
+
+    QTextStream out(stdout);
+    out << qSetFieldWidth(22) << left << "preset" << qSetFieldWidth(6) << "dpr"
+        << qSetFieldWidth(8) << "kernel" << qSetFieldWidth(14) << "generic (ms)" << "special (ms)"
+        << qSetFieldWidth(8) << "speedup" << qSetFieldWidth(0) << endl;
+
+    bool identical = true;
+    for (const ShadowPreset &preset : s_shadowPresets) {
+        for (const qreal dpr : s_devicePixelRatios) {
+            for (const auto &kernel : kernels) {
+                if (!BoxBlur::isKernelSupported(kernel.kernel)) {
+                    continue;
+                }
+                BoxBlur::setKernel(kernel.kernel);
+
+                if (renderPreset(preset, dpr, false) != renderPreset(preset, dpr, true)) {
+                    identical = false;
+                    out << "MISMATCH " << preset.name << " at " << dpr << " with " << kernel.name << endl;
+                }
+
+                const qreal generic = timePreset(preset, dpr, false);
+                const qreal specialized = timePreset(preset, dpr, true);
+
+                out << qSetFieldWidth(22) << left << preset.name << qSetFieldWidth(6) << dpr
+                    << qSetFieldWidth(8) << kernel.name << qSetFieldWidth(14)
+                    << QString::number(generic, 'f', 3) << QString::number(specialized, 'f', 3)
+                    << qSetFieldWidth(8) << QString::number(generic / specialized, 'f', 2)
+                    << qSetFieldWidth(0) << endl;
+            }
+        }
+    }
+
+    return identical ? 0 : 1;
+}
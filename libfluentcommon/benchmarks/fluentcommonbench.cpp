@@ -0,0 +1,238 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Benchmark of the shadow rendering of libfluentcommon.
+ *
+ * Without arguments, BoxShadowRenderer::render(), boxBlurAlpha() and
+ * mirrorTopLeftQuadrant() are timed for every shadow preset, box size and
+ * device pixel ratio. The results are printed as JSON, with the number of
+ * heap allocations and of bytes allocated by one run, and an estimate of
+ * the bytes one run reads and writes.
+ *
+ * --print-golden prints the golden checksums of fluentshadowgolden.h, the
+ * blurred and mirrored shadow masks of every preset. The shadowgoldentest
+ * autotest checks every blur kernel against them.
+ */
+
+// own
+#include "fluentbenchmark.h"
+#include "fluentboxshadowrenderer.h"
+#include "fluentshadowgolden.h"
+#include "fluentshadowpresets.h"
+
+// Qt
+#include <QElapsedTimer>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+#include <functional>
+
+using namespace Fluent;
+
+// the box sizes, as multiples of the minimum box size of a preset
+static const int s_boxScales[] = { 1, 2, 4 };
+
+// The bytes boxBlurAlpha() reads and writes: the image once, then two
+// transposes and six lane passes over a compact alpha plane.
+static qint64 blurBytes(const QRect &rect, int bytesPerPixel)
+{
+    const qint64 area = qint64(rect.width()) * rect.height();
+    return area * (2 * bytesPerPixel + 16);
+}
+
+// The bytes mirrorTopLeftQuadrant() reads and writes.
+static qint64 mirrorBytes(const QImage &image)
+{
+    const QRect quadrant = topLeftQuadrant(image);
+    return 2 * (qint64(quadrant.width()) * quadrant.height() + qint64(quadrant.height()) * image.width());
+}
+
+// The bytes render() reads and writes, with the box blur engine.
+static qint64 renderBytes(const ShadowPreset &preset, const QSize &boxSize, qreal dpr)
+{
+    const QSize textureSize = BoxShadowRenderer::calculateMinimumShadowTextureSize(boxSize, preset.radius1, preset.offset1)
+        .expandedTo(BoxShadowRenderer::calculateMinimumShadowTextureSize(boxSize, preset.radius2, preset.offset2));
+
+    // filling the canvas
+    qint64 bytes = qint64(textureSize.width() * dpr) * qint64(textureSize.height() * dpr) * 4;
+
+    for (const int radius : { preset.radius1, preset.radius2 }) {
+        const QImage mask = shadowMask(boxSize, radius, dpr);
+        const qint64 maskBytes = qint64(mask.width()) * mask.height();
+
+        // fill and box, blur, mirror, then composite over the canvas
+        bytes += 2 * maskBytes;
+        bytes += blurBytes(topLeftQuadrant(mask), 1);
+        bytes += mirrorBytes(mask);
+        bytes += maskBytes * (1 + 2 * 4);
+    }
+
+    return bytes;
+}
+
+// Time an operation, at least 5 times and for at least 200ms. The setup is
+// not timed, it runs before every iteration.
+static QJsonObject measure(const std::function<void()> &setup, const std::function<void()> &operation)
+{
+    QElapsedTimer total;
+    QElapsedTimer timer;
+    total.start();
+
+    int iterations = 0;
+    qint64 elapsed = 0;
+    qint64 fastest = -1;
+    do {
+        setup();
+        timer.start();
+        operation();
+        const qint64 nsecs = timer.nsecsElapsed();
+
+        elapsed += nsecs;
+        fastest = fastest < 0 ? nsecs : qMin(fastest, nsecs);
+        ++iterations;
+    } while (iterations < 5 || total.elapsed() < 200);
+
+    QJsonObject result;
+    result[QStringLiteral("iterations")] = iterations;
+    result[QStringLiteral("meanMs")] = elapsed / 1e6 / iterations;
+    result[QStringLiteral("minMs")] = fastest / 1e6;
+
+#if FLUENT_COUNT_ALLOCATIONS
+    setup();
+    AllocationCounter allocations;
+    allocations.start();
+    operation();
+    allocations.stop();
+    result[QStringLiteral("allocations")] = allocations.allocations();
+    result[QStringLiteral("allocatedBytes")] = allocations.bytes();
+#else
+    result[QStringLiteral("allocations")] = QJsonValue();
+    result[QStringLiteral("allocatedBytes")] = QJsonValue();
+#endif
+
+    return result;
+}
+
+static QJsonObject record(const char *operation, const ShadowPreset &preset, const QSize &boxSize, qreal dpr, int layer)
+{
+    QJsonObject result;
+    result[QStringLiteral("operation")] = QLatin1String(operation);
+    result[QStringLiteral("preset")] = QLatin1String(preset.name);
+    result[QStringLiteral("boxSize")] = boxSize.width();
+    result[QStringLiteral("dpr")] = dpr;
+    if (layer > 0) {
+        result[QStringLiteral("layer")] = layer;
+    }
+    return result;
+}
+
+static QJsonObject merged(QJsonObject object, const QJsonObject &other)
+{
+    for (auto it = other.constBegin(); it != other.constEnd(); ++it) {
+        object[it.key()] = it.value();
+    }
+    return object;
+}
+
+static void benchmark()
+{
+    QJsonArray results;
+
+    for (const ShadowPreset &preset : s_shadowPresets) {
+        for (const int boxScale : s_boxScales) {
+            const QSize boxSize = preset.boxSize() * boxScale;
+
+            for (const qreal dpr : s_devicePixelRatios) {
+                BoxShadowRenderer renderer;
+                preset.setup(renderer, dpr, boxSize);
+
+                QJsonObject entry = record("render", preset, boxSize, dpr, 0);
+                entry = merged(entry, measure([] {}, [&renderer] { renderer.render(); }));
+                entry[QStringLiteral("bytesTouched")] = renderBytes(preset, boxSize, dpr);
+                results.append(entry);
+
+                const int radii[] = { preset.radius1, preset.radius2 };
+                for (int layer = 1; layer <= 2; ++layer) {
+                    const int radius = radii[layer - 1];
+                    const QImage source = shadowMask(boxSize, radius, dpr);
+                    const QRect quadrant = topLeftQuadrant(source);
+                    QImage mask;
+
+                    // Copy the source before every run, so each run blurs the
+                    // same pixels, and the copy itself is not timed.
+                    const std::function<void()> reset = [&mask, &source] {
+                        mask = source;
+                        mask.bits();
+                    };
+
+                    entry = record("boxBlurAlpha", preset, boxSize, dpr, layer);
+                    entry = merged(entry, measure(reset, [&mask, radius, dpr, quadrant] {
+                        BoxShadowRenderer::boxBlurAlpha(mask, qRound(radius * dpr), quadrant);
+                    }));
+                    entry[QStringLiteral("bytesTouched")] = blurBytes(quadrant, 1);
+                    results.append(entry);
+
+                    entry = record("mirrorTopLeftQuadrant", preset, boxSize, dpr, layer);
+                    entry = merged(entry, measure(reset, [&mask] {
+                        BoxShadowRenderer::mirrorTopLeftQuadrant(mask);
+                    }));
+                    entry[QStringLiteral("bytesTouched")] = mirrorBytes(source);
+                    results.append(entry);
+                }
+            }
+        }
+    }
+
+    QJsonObject document;
+    document[QStringLiteral("countsAllocations")] = bool(FLUENT_COUNT_ALLOCATIONS);
+    document[QStringLiteral("results")] = results;
+
+    QTextStream(stdout) << QJsonDocument(document).toJson();
+}
+
+static void printGolden()
+{
+    QTextStream out(stdout);
+    for (const ShadowPreset &preset : s_shadowPresets) {
+        for (const qreal dpr : s_devicePixelRatios) {
+            for (int layer = 1; layer <= 2; ++layer) {
+                out << "    { \"" << preset.name << "\", " << QString::number(dpr, 'f', 1) << ", " << layer
+                    << ", Q_UINT64_C(0x" << QString::number(alphaChecksum(goldenMask(preset, dpr, layer)), 16) << ") }," << endl;
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication app(argc, argv);
+
+    const QStringList arguments = app.arguments();
+    if (arguments.contains(QStringLiteral("--print-golden"))) {
+        printGolden();
+        return 0;
+    }
+
+    benchmark();
+    return 0;
+}
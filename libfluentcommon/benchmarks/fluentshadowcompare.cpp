@@ -0,0 +1,101 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Compare the Gaussian shadow engine with the box blur one.
+ *
+ * For every shadow preset and device pixel ratio, both engines render the
+ * shadow texture. The harness prints the maximum and the mean difference of
+ * the alpha channels, in 1/255 steps, and the time each engine takes.
+ */
+
+// own
+#include "fluentboxshadowrenderer.h"
+#include "fluentshadowpresets.h"
+
+// Qt
+#include <QElapsedTimer>
+#include <QGuiApplication>
+#include <QTextStream>
+
+using namespace Fluent;
+
+static QImage renderPreset(const ShadowPreset &preset, qreal dpr, BoxShadowRenderer::Engine engine)
+{
+    BoxShadowRenderer renderer;
+    renderer.setEngine(engine);
+    preset.setup(renderer, dpr);
+    return renderer.render();
+}
+
+static qreal timePreset(const ShadowPreset &preset, qreal dpr, BoxShadowRenderer::Engine engine)
+{
+    // Run for at least 200ms, and at least 5 times, and report the average.
+    QElapsedTimer timer;
+    timer.start();
+
+    int iterations = 0;
+    do {
+        renderPreset(preset, dpr, engine);
+        ++iterations;
+    } while (iterations < 5 || timer.elapsed() < 200);
+
+    return timer.nsecsElapsed() / 1e6 / iterations;
+}
+
+int main(int argc, char **argv)
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication app(argc, argv);
+
+    QTextStream out(stdout);
+    out << qSetFieldWidth(22) << left << "preset" << qSetFieldWidth(6) << "dpr"
+        << qSetFieldWidth(10) << "size" << "max err" << "mean err"
+        << qSetFieldWidth(12) << "box (ms)" << "gauss (ms)" << qSetFieldWidth(0) << endl;
+
+    for (const ShadowPreset &preset : s_shadowPresets) {
+        for (const qreal dpr : s_devicePixelRatios) {
+            const QImage box = renderPreset(preset, dpr, BoxShadowRenderer::BoxBlurEngine);
+            const QImage gaussian = renderPreset(preset, dpr, BoxShadowRenderer::GaussianEngine);
+            Q_ASSERT(box.size() == gaussian.size());
+
+            int maxError = 0;
+            qint64 totalError = 0;
+            for (int y = 0; y < box.height(); ++y) {
+                const QRgb *boxLine = reinterpret_cast<const QRgb *>(box.constScanLine(y));
+                const QRgb *gaussianLine = reinterpret_cast<const QRgb *>(gaussian.constScanLine(y));
+                for (int x = 0; x < box.width(); ++x) {
+                    const int error = qAbs(qAlpha(boxLine[x]) - qAlpha(gaussianLine[x]));
+                    maxError = qMax(maxError, error);
+                    totalError += error;
+                }
+            }
+            const qreal meanError = qreal(totalError) / (box.width() * box.height());
+
+            out << qSetFieldWidth(22) << left << preset.name << qSetFieldWidth(6) << dpr
+                << qSetFieldWidth(10) << QStringLiteral("%1x%2").arg(box.width()).arg(box.height())
+                << maxError << QString::number(meanError, 'f', 3)
+                << qSetFieldWidth(12)
+                << QString::number(timePreset(preset, dpr, BoxShadowRenderer::BoxBlurEngine), 'f', 3)
+                << QString::number(timePreset(preset, dpr, BoxShadowRenderer::GaussianEngine), 'f', 3)
+                << qSetFieldWidth(0) << endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,173 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#pragma once
+
+// own
+#include "fluentboxshadowrenderer.h"
+#include "fluentshadowpresets.h"
+
+// Qt
+#include <QImage>
+#include <QRect>
+#include <QtGlobal>
+#include <QtMath>
+
+#include <cstring>
+
+namespace Fluent
+{
+
+/**
+ * An opaque box with a transparent margin as wide as the blur extent, like
+ * the masks BoxShadowRenderer blurs, without the rounded corners.
+ **/
+inline QImage shadowMask(const QSize &boxSize, int radius, qreal dpr)
+{
+    const QSize size = BoxShadowRenderer::calculateMinimumShadowTextureSize(boxSize, radius, QPoint());
+    const int margin = qRound((size.width() - boxSize.width()) / 2 * dpr);
+
+    QImage mask(qRound(size.width() * dpr), qRound(size.height() * dpr), QImage::Format_Alpha8);
+    mask.fill(0);
+    for (int y = margin; y < mask.height() - margin; ++y) {
+        memset(mask.scanLine(y) + margin, 255, mask.width() - 2 * margin);
+    }
+
+    return mask;
+}
+
+/**
+ * The part of a mask that is blurred, the rest is mirrored from it.
+ **/
+inline QRect topLeftQuadrant(const QImage &image)
+{
+    return QRect(0, 0, qCeil(image.width() * 0.5), qCeil(image.height() * 0.5));
+}
+
+/**
+ * FNV-1a over the alpha values, row by row.
+ **/
+inline quint64 alphaChecksum(const QImage &image)
+{
+    const int offset = image.depth() == 8 || QSysInfo::ByteOrder == QSysInfo::BigEndian ? 0 : 3;
+    const int stride = image.depth() >> 3;
+
+    quint64 hash = Q_UINT64_C(14695981039346656037);
+    for (int y = 0; y < image.height(); ++y) {
+        const uchar *in = image.constScanLine(y) + offset;
+        for (int x = 0; x < image.width(); ++x, in += stride) {
+            hash = (hash ^ *in) * Q_UINT64_C(1099511628211);
+        }
+    }
+    return hash;
+}
+
+/**
+ * The blurred and mirrored mask of one layer of a preset, with the kernel
+ * that is currently selected, see BoxBlur::setKernel().
+ **/
+inline QImage goldenMask(const ShadowPreset &preset, qreal dpr, int layer)
+{
+    const int radius = layer == 1 ? preset.radius1 : preset.radius2;
+
+    QImage mask = shadowMask(preset.boxSize(), radius, dpr);
+    BoxShadowRenderer::boxBlurAlpha(mask, qRound(radius * dpr), topLeftQuadrant(mask));
+    BoxShadowRenderer::mirrorTopLeftQuadrant(mask);
+    return mask;
+}
+
+/**
+ * The checksum of the alpha values of one blurred and mirrored shadow mask.
+ **/
+struct GoldenChecksum
+{
+    const char *preset;
+    qreal dpr;
+    int layer;
+    quint64 checksum;
+};
+
+// Generated with "fluentcommon_bench --print-golden", they match the output of
+// the original strided box blur. The shadowgoldentest autotest compares every
+// kernel with them. Only regenerate them for an intended change.
+static const GoldenChecksum s_goldenChecksums[] = {
+    { "decoration/Small", 1.0, 1, Q_UINT64_C(0xe2cc8323bf629eee) },
+    { "decoration/Small", 1.0, 2, Q_UINT64_C(0x14f2f1e9fc52d356) },
+    { "decoration/Small", 1.5, 1, Q_UINT64_C(0x26e12741dec18e71) },
+    { "decoration/Small", 1.5, 2, Q_UINT64_C(0xc93c2a3726601029) },
+    { "decoration/Small", 2.0, 1, Q_UINT64_C(0xa410043c74402fd1) },
+    { "decoration/Small", 2.0, 2, Q_UINT64_C(0xe85835ea007c1ba5) },
+    { "decoration/Small", 3.0, 1, Q_UINT64_C(0xf7e754e296ee5b0e) },
+    { "decoration/Small", 3.0, 2, Q_UINT64_C(0xefcb6bc1a5402f16) },
+    { "decoration/Medium", 1.0, 1, Q_UINT64_C(0xb483fc4a45da8896) },
+    { "decoration/Medium", 1.0, 2, Q_UINT64_C(0xb6f9bfdc16149286) },
+    { "decoration/Medium", 1.5, 1, Q_UINT64_C(0x662df77133699755) },
+    { "decoration/Medium", 1.5, 2, Q_UINT64_C(0xff8841da10fde94d) },
+    { "decoration/Medium", 2.0, 1, Q_UINT64_C(0x6d535ae3bc3e80f1) },
+    { "decoration/Medium", 2.0, 2, Q_UINT64_C(0x55c1e30b771eb611) },
+    { "decoration/Medium", 3.0, 1, Q_UINT64_C(0x4e2e92ee97319d3e) },
+    { "decoration/Medium", 3.0, 2, Q_UINT64_C(0x2a6993943094d316) },
+    { "decoration/Large", 1.0, 1, Q_UINT64_C(0x4262235a32c8b016) },
+    { "decoration/Large", 1.0, 2, Q_UINT64_C(0x7558a5548558ed56) },
+    { "decoration/Large", 1.5, 1, Q_UINT64_C(0xb9bdd3f90ca094c9) },
+    { "decoration/Large", 1.5, 2, Q_UINT64_C(0x49629d49cd0950e1) },
+    { "decoration/Large", 2.0, 1, Q_UINT64_C(0xc1c50e79fb5d6a49) },
+    { "decoration/Large", 2.0, 2, Q_UINT64_C(0xe752c3c3fee05c91) },
+    { "decoration/Large", 3.0, 1, Q_UINT64_C(0x7eba015ca21717ee) },
+    { "decoration/Large", 3.0, 2, Q_UINT64_C(0x943d70d2beb1854e) },
+    { "decoration/VeryLarge", 1.0, 1, Q_UINT64_C(0x83cb4085b3ceafe6) },
+    { "decoration/VeryLarge", 1.0, 2, Q_UINT64_C(0xc226b70eabbdc4d6) },
+    { "decoration/VeryLarge", 1.5, 1, Q_UINT64_C(0x6ebe361a9a2102ed) },
+    { "decoration/VeryLarge", 1.5, 2, Q_UINT64_C(0xac4707dd2d5f33f6) },
+    { "decoration/VeryLarge", 2.0, 1, Q_UINT64_C(0x4f4dc630c227e739) },
+    { "decoration/VeryLarge", 2.0, 2, Q_UINT64_C(0xd04d05510f9ea1c1) },
+    { "decoration/VeryLarge", 3.0, 1, Q_UINT64_C(0xaadf5c5231e5090e) },
+    { "decoration/VeryLarge", 3.0, 2, Q_UINT64_C(0xe638fb7ddc9e784e) },
+    { "style/Small", 1.0, 1, Q_UINT64_C(0xa6191a213fd494e) },
+    { "style/Small", 1.0, 2, Q_UINT64_C(0xbefec275e3e73366) },
+    { "style/Small", 1.5, 1, Q_UINT64_C(0x6889280c46e6a81d) },
+    { "style/Small", 1.5, 2, Q_UINT64_C(0x1174cb419600101e) },
+    { "style/Small", 2.0, 1, Q_UINT64_C(0x6e0342d1c147a939) },
+    { "style/Small", 2.0, 2, Q_UINT64_C(0x150d18d9cafff2c1) },
+    { "style/Small", 3.0, 1, Q_UINT64_C(0xb7b878195deb2ed6) },
+    { "style/Small", 3.0, 2, Q_UINT64_C(0xc89ec97280650aee) },
+    { "style/Medium", 1.0, 1, Q_UINT64_C(0xe2cc8323bf629eee) },
+    { "style/Medium", 1.0, 2, Q_UINT64_C(0x14f2f1e9fc52d356) },
+    { "style/Medium", 1.5, 1, Q_UINT64_C(0x26e12741dec18e71) },
+    { "style/Medium", 1.5, 2, Q_UINT64_C(0xc93c2a3726601029) },
+    { "style/Medium", 2.0, 1, Q_UINT64_C(0xa410043c74402fd1) },
+    { "style/Medium", 2.0, 2, Q_UINT64_C(0xe85835ea007c1ba5) },
+    { "style/Medium", 3.0, 1, Q_UINT64_C(0xf7e754e296ee5b0e) },
+    { "style/Medium", 3.0, 2, Q_UINT64_C(0xefcb6bc1a5402f16) },
+    { "style/Large", 1.0, 1, Q_UINT64_C(0xc6cb96f74d46c036) },
+    { "style/Large", 1.0, 2, Q_UINT64_C(0x961af65fccc4441e) },
+    { "style/Large", 1.5, 1, Q_UINT64_C(0x1e0f3c54456c0a69) },
+    { "style/Large", 1.5, 2, Q_UINT64_C(0x371e74de74404849) },
+    { "style/Large", 2.0, 1, Q_UINT64_C(0xe761935a19323049) },
+    { "style/Large", 2.0, 2, Q_UINT64_C(0x6bf3dcf7bed9642d) },
+    { "style/Large", 3.0, 1, Q_UINT64_C(0x933b7c2ddc22c556) },
+    { "style/Large", 3.0, 2, Q_UINT64_C(0x91cfe7471e51fa06) },
+    { "style/VeryLarge", 1.0, 1, Q_UINT64_C(0x531105624f96a8b6) },
+    { "style/VeryLarge", 1.0, 2, Q_UINT64_C(0xa9c08af85396b436) },
+    { "style/VeryLarge", 1.5, 1, Q_UINT64_C(0x89760c17d62432e5) },
+    { "style/VeryLarge", 1.5, 2, Q_UINT64_C(0x90bc4987bb0302c6) },
+    { "style/VeryLarge", 2.0, 1, Q_UINT64_C(0xd523bc5f956d6a71) },
+    { "style/VeryLarge", 2.0, 2, Q_UINT64_C(0x743150c987911fd9) },
+    { "style/VeryLarge", 3.0, 1, Q_UINT64_C(0x4757f9b99dbc3d16) },
+    { "style/VeryLarge", 3.0, 2, Q_UINT64_C(0x5c379c58506749fe) },
+};
+
+} // namespace Fluent
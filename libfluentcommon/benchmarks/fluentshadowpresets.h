@@ -0,0 +1,111 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#pragma once
+
+// own
+#include "fluentboxshadowrenderer.h"
+#include "fluentshadowparams.h"
+
+// Qt
+#include <QColor>
+#include <QPoint>
+#include <QSize>
+#include <QString>
+
+namespace Fluent
+{
+
+/**
+ * A shadow preset, as used by the decoration and by the widget style.
+ **/
+struct ShadowPreset
+{
+    const char *name;
+    qreal borderRadius;
+    QPoint offset1;
+    int radius1;
+    qreal opacity1;
+    QPoint offset2;
+    int radius2;
+    qreal opacity2;
+
+    /**
+     * The size of the box the shadow is rendered for.
+     **/
+    QSize boxSize() const
+    {
+        return BoxShadowRenderer::calculateMinimumBoxSize(radius1)
+            .expandedTo(BoxShadowRenderer::calculateMinimumBoxSize(radius2));
+    }
+
+    /**
+     * Set up a renderer for this preset.
+     *
+     * @param renderer The renderer, it must not have any shadows yet.
+     * @param dpr The device pixel ratio.
+     * @param size The size of the box, boxSize() if it is not valid.
+     **/
+    void setup(BoxShadowRenderer &renderer, qreal dpr, const QSize &size = QSize()) const
+    {
+        renderer.setBorderRadius(borderRadius);
+        renderer.setBoxSize(size.isValid() ? size : boxSize());
+        renderer.setDevicePixelRatio(dpr);
+        renderer.addShadow(offset1, radius1, withOpacity(opacity1));
+        renderer.addShadow(offset2, radius2, withOpacity(opacity2));
+    }
+
+    static QColor withOpacity(qreal opacity)
+    {
+        QColor color(Qt::black);
+        color.setAlphaF(opacity);
+        return color;
+    }
+
+    /**
+     * The preset for a shadow of the decoration or of the widget style.
+     *
+     * @param name The name of the preset.
+     * @param borderRadius The border radius of the box.
+     * @param params The shadow, from fluentshadowparams.h.
+     **/
+    static ShadowPreset create(const char *name, qreal borderRadius, const CompositeShadowParams &params)
+    {
+        const ShadowPreset preset = {
+            name, borderRadius,
+            params.shadow1.offset, params.shadow1.radius, params.shadow1.opacity,
+            params.shadow2.offset, params.shadow2.radius, params.shadow2.opacity
+        };
+        return preset;
+    }
+};
+
+static const ShadowPreset s_shadowPresets[] = {
+    // kwin decoration, Frame_FrameRadius + 0.5
+    ShadowPreset::create("decoration/Small", 4.5, s_decorationShadowParams[ShadowSmall]),
+    ShadowPreset::create("decoration/Medium", 4.5, s_decorationShadowParams[ShadowMedium]),
+    ShadowPreset::create("decoration/Large", 4.5, s_decorationShadowParams[ShadowLarge]),
+    ShadowPreset::create("decoration/VeryLarge", 4.5, s_decorationShadowParams[ShadowVeryLarge]),
+    // menus and tooltips, Helper::frameRadius()
+    ShadowPreset::create("style/Small", 3, s_styleShadowParams[ShadowSmall]),
+    ShadowPreset::create("style/Medium", 3, s_styleShadowParams[ShadowMedium]),
+    ShadowPreset::create("style/Large", 3, s_styleShadowParams[ShadowLarge]),
+    ShadowPreset::create("style/VeryLarge", 3, s_styleShadowParams[ShadowVeryLarge]),
+};
+
+static const qreal s_devicePixelRatios[] = { 1.0, 1.5, 2.0, 3.0 };
+
+} // namespace Fluent
@@ -0,0 +1,811 @@
+/*
+ * The box blur implementation is based on AlphaBoxBlur from Firefox.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// own
+#include "fluentboxblur.h"
+
+// auto-generated
+#include "config-fluentcommon.h"
+
+// Qt
+#include <QFuture>
+#include <QScopedPointer>
+#include <QSysInfo>
+#include <QThread>
+#include <QVarLengthArray>
+#include <QtConcurrentRun>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FLUENT_BOXBLUR_X86 1
+#include <immintrin.h>
+#define FLUENT_TARGET_SSE2 __attribute__((target("sse2")))
+#define FLUENT_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define FLUENT_BOXBLUR_X86 0
+#endif
+
+namespace Fluent
+{
+
+/**
+ * Process a lane with a box filter.
+ *
+ * @param src The start of the lane.
+ * @param inputStep The number of bytes from one input value to the next one.
+ * @param dst The destination.
+ * @param outputStep The number of bytes from one output value to the next one.
+ * @param width The number of values in the lane.
+ * @param lobes Params of the box filter.
+ **/
+static inline void boxBlurRowAlpha(const uint8_t *src, int inputStep, uint8_t *dst, int outputStep,
+                                   int width, const BoxLobes &lobes)
+{
+    const int boxSize = lobes.left + 1 + lobes.right;
+    const int reciprocal = (1 << 24) / boxSize;
+
+    uint32_t alphaSum = (boxSize + 1) / 2;
+
+    const uint8_t *left = src;
+    const uint8_t *right = src;
+    uint8_t *out = dst;
+
+    const uint8_t firstValue = src[0];
+    const uint8_t lastValue = src[(width - 1) * inputStep];
+
+    alphaSum += firstValue * lobes.left;
+
+    const uint8_t *initEnd = src + (boxSize - lobes.left) * inputStep;
+    while (right < initEnd) {
+        alphaSum += *right;
+        right += inputStep;
+    }
+
+    const uint8_t *leftEnd = src + boxSize * inputStep;
+    while (right < leftEnd) {
+        *out = (alphaSum * reciprocal) >> 24;
+        alphaSum += *right - firstValue;
+        right += inputStep;
+        out += outputStep;
+    }
+
+    const uint8_t *centerEnd = src + width * inputStep;
+    while (right < centerEnd) {
+        *out = (alphaSum * reciprocal) >> 24;
+        alphaSum += *right - *left;
+        left += inputStep;
+        right += inputStep;
+        out += outputStep;
+    }
+
+    const uint8_t *rightEnd = dst + width * outputStep;
+    while (out < rightEnd) {
+        *out = (alphaSum * reciprocal) >> 24;
+        alphaSum += lastValue - *left;
+        left += inputStep;
+        out += outputStep;
+    }
+}
+
+/**
+ * Process several lanes with a box filter, one value of every lane at a time.
+ *
+ * This keeps the memory accesses sequential when the lanes are interleaved,
+ * and gives the compiler a chance to auto-vectorize the inner loops.
+ *
+ * A non-zero @p FixedBoxSize must be the size of the box given by @p lobes,
+ * the kernel is then compiled for that box size, see specializedKernels().
+ **/
+template<int FixedBoxSize>
+static void blurLanesScalar(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                            int length, int lanes, const BoxLobes &lobes)
+{
+    const int boxSize = FixedBoxSize ? FixedBoxSize : lobes.left + 1 + lobes.right;
+
+    if (length < boxSize) {
+        for (int i = 0; i < lanes; ++i) {
+            boxBlurRowAlpha(src + i, srcStride, dst + i, dstStride, length, lobes);
+        }
+        return;
+    }
+
+    const uint32_t reciprocal = (1 << 24) / boxSize;
+
+    QVarLengthArray<uint32_t, 256> alphaSum(lanes);
+
+    const uint8_t *firstValue = src;
+    const uint8_t *lastValue = src + (length - 1) * srcStride;
+
+    for (int i = 0; i < lanes; ++i) {
+        alphaSum[i] = (boxSize + 1) / 2 + firstValue[i] * lobes.left;
+    }
+
+    const uint8_t *left = src;
+    const uint8_t *right = src;
+    uint8_t *out = dst;
+
+    const uint8_t *initEnd = src + (boxSize - lobes.left) * srcStride;
+    while (right < initEnd) {
+        for (int i = 0; i < lanes; ++i) {
+            alphaSum[i] += right[i];
+        }
+        right += srcStride;
+    }
+
+    const uint8_t *leftEnd = src + boxSize * srcStride;
+    while (right < leftEnd) {
+        for (int i = 0; i < lanes; ++i) {
+            const uint32_t sum = alphaSum[i];
+            out[i] = (sum * reciprocal) >> 24;
+            alphaSum[i] = sum + right[i] - firstValue[i];
+        }
+        right += srcStride;
+        out += dstStride;
+    }
+
+    const uint8_t *centerEnd = src + length * srcStride;
+    while (right < centerEnd) {
+        for (int i = 0; i < lanes; ++i) {
+            const uint32_t sum = alphaSum[i];
+            out[i] = (sum * reciprocal) >> 24;
+            alphaSum[i] = sum + right[i] - left[i];
+        }
+        left += srcStride;
+        right += srcStride;
+        out += dstStride;
+    }
+
+    const uint8_t *rightEnd = dst + length * dstStride;
+    while (out < rightEnd) {
+        for (int i = 0; i < lanes; ++i) {
+            const uint32_t sum = alphaSum[i];
+            out[i] = (sum * reciprocal) >> 24;
+            alphaSum[i] = sum + lastValue[i] - left[i];
+        }
+        left += srcStride;
+        out += dstStride;
+    }
+}
+
+#if FLUENT_BOXBLUR_X86
+
+// The running sums are kept in 32-bit integers, exactly like in the scalar
+// kernel. The product of a sum and the reciprocal of the box size never
+// exceeds 32 bits, so the vector kernels can't diverge from the scalar one.
+
+FLUENT_TARGET_SSE2
+static inline __m128i mulLo32Sse2(__m128i a, __m128i b)
+{
+    const __m128i even = _mm_mul_epu32(a, b);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+FLUENT_TARGET_SSE2
+static inline void loadSse2(const uint8_t *src, __m128i out[4])
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+    const __m128i lo = _mm_unpacklo_epi8(value, zero);
+    const __m128i hi = _mm_unpackhi_epi8(value, zero);
+    out[0] = _mm_unpacklo_epi16(lo, zero);
+    out[1] = _mm_unpackhi_epi16(lo, zero);
+    out[2] = _mm_unpacklo_epi16(hi, zero);
+    out[3] = _mm_unpackhi_epi16(hi, zero);
+}
+
+FLUENT_TARGET_SSE2
+static inline void storeSse2(uint8_t *dst, const __m128i sum[4], __m128i reciprocal)
+{
+    __m128i value[4];
+    for (int i = 0; i < 4; ++i) {
+        value[i] = _mm_srli_epi32(mulLo32Sse2(sum[i], reciprocal), 24);
+    }
+    const __m128i lo = _mm_packs_epi32(value[0], value[1]);
+    const __m128i hi = _mm_packs_epi32(value[2], value[3]);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm_packus_epi16(lo, hi));
+}
+
+/**
+ * Process 16 lanes with a box filter.
+ **/
+template<int FixedBoxSize>
+FLUENT_TARGET_SSE2
+static void blurLanesSse2(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                          int length, const BoxLobes &lobes)
+{
+    const int boxSize = FixedBoxSize ? FixedBoxSize : lobes.left + 1 + lobes.right;
+    const __m128i reciprocal = _mm_set1_epi32((1 << 24) / boxSize);
+
+    __m128i firstValue[4];
+    __m128i lastValue[4];
+    loadSse2(src, firstValue);
+    loadSse2(src + (length - 1) * srcStride, lastValue);
+
+    __m128i alphaSum[4];
+    const __m128i leftCount = _mm_set1_epi32(lobes.left);
+    for (int i = 0; i < 4; ++i) {
+        alphaSum[i] = _mm_add_epi32(_mm_set1_epi32((boxSize + 1) / 2), mulLo32Sse2(firstValue[i], leftCount));
+    }
+
+    const uint8_t *left = src;
+    const uint8_t *right = src;
+    uint8_t *out = dst;
+
+    __m128i in[4];
+    __m128i outgoing[4];
+
+    const uint8_t *initEnd = src + (boxSize - lobes.left) * srcStride;
+    while (right < initEnd) {
+        loadSse2(right, in);
+        for (int i = 0; i < 4; ++i) {
+            alphaSum[i] = _mm_add_epi32(alphaSum[i], in[i]);
+        }
+        right += srcStride;
+    }
+
+    const uint8_t *leftEnd = src + boxSize * srcStride;
+    while (right < leftEnd) {
+        storeSse2(out, alphaSum, reciprocal);
+        loadSse2(right, in);
+        for (int i = 0; i < 4; ++i) {
+            alphaSum[i] = _mm_sub_epi32(_mm_add_epi32(alphaSum[i], in[i]), firstValue[i]);
+        }
+        right += srcStride;
+        out += dstStride;
+    }
+
+    const uint8_t *centerEnd = src + length * srcStride;
+    while (right < centerEnd) {
+        storeSse2(out, alphaSum, reciprocal);
+        loadSse2(right, in);
+        loadSse2(left, outgoing);
+        for (int i = 0; i < 4; ++i) {
+            alphaSum[i] = _mm_sub_epi32(_mm_add_epi32(alphaSum[i], in[i]), outgoing[i]);
+        }
+        left += srcStride;
+        right += srcStride;
+        out += dstStride;
+    }
+
+    const uint8_t *rightEnd = dst + length * dstStride;
+    while (out < rightEnd) {
+        storeSse2(out, alphaSum, reciprocal);
+        loadSse2(left, outgoing);
+        for (int i = 0; i < 4; ++i) {
+            alphaSum[i] = _mm_sub_epi32(_mm_add_epi32(alphaSum[i], lastValue[i]), outgoing[i]);
+        }
+        left += srcStride;
+        out += dstStride;
+    }
+}
+
+FLUENT_TARGET_AVX2
+static inline void loadAvx2(const uint8_t *src, __m256i out[4])
+{
+    const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+    const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 16));
+    out[0] = _mm256_cvtepu8_epi32(lo);
+    out[1] = _mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8));
+    out[2] = _mm256_cvtepu8_epi32(hi);
+    out[3] = _mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8));
+}
+
+FLUENT_TARGET_AVX2
+static inline void storeAvx2(uint8_t *dst, const __m256i sum[4], __m256i reciprocal)
+{
+    __m256i value[4];
+    for (int i = 0; i < 4; ++i) {
+        value[i] = _mm256_srli_epi32(_mm256_mullo_epi32(sum[i], reciprocal), 24);
+    }
+    // Packing works within 128-bit halves, put the 4-byte groups back in order.
+    const __m256i lo = _mm256_packus_epi32(value[0], value[1]);
+    const __m256i hi = _mm256_packus_epi32(value[2], value[3]);
+    const __m256i packed = _mm256_packus_epi16(lo, hi);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), _mm256_permutevar8x32_epi32(packed, order));
+}
+
+/**
+ * Process 32 lanes with a box filter.
+ **/
+template<int FixedBoxSize>
+FLUENT_TARGET_AVX2
+static void blurLanesAvx2(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                          int length, const BoxLobes &lobes)
+{
+    const int boxSize = FixedBoxSize ? FixedBoxSize : lobes.left + 1 + lobes.right;
+    const __m256i reciprocal = _mm256_set1_epi32((1 << 24) / boxSize);
+
+    __m256i firstValue[4];
+    __m256i lastValue[4];
+    loadAvx2(src, firstValue);
+    loadAvx2(src + (length - 1) * srcStride, lastValue);
+
+    __m256i alphaSum[4];
+    const __m256i leftCount = _mm256_set1_epi32(lobes.left);
+    for (int i = 0; i < 4; ++i) {
+        alphaSum[i] = _mm256_add_epi32(_mm256_set1_epi32((boxSize + 1) / 2), _mm256_mullo_epi32(firstValue[i], leftCount));
+    }
+
+    const uint8_t *left = src;
+    const uint8_t *right = src;
+    uint8_t *out = dst;
+
+    __m256i in[4];
+    __m256i outgoing[4];
+
+    const uint8_t *initEnd = src + (boxSize - lobes.left) * srcStride;
+    while (right < initEnd) {
+        loadAvx2(right, in);
+        for (int i = 0; i < 4; ++i) {
+            alphaSum[i] = _mm256_add_epi32(alphaSum[i], in[i]);
+        }
+        right += srcStride;
+    }
+
+    const uint8_t *leftEnd = src + boxSize * srcStride;
+    while (right < leftEnd) {
+        storeAvx2(out, alphaSum, reciprocal);
+        loadAvx2(right, in);
+        for (int i = 0; i < 4; ++i) {
+            alphaSum[i] = _mm256_sub_epi32(_mm256_add_epi32(alphaSum[i], in[i]), firstValue[i]);
+        }
+        right += srcStride;
+        out += dstStride;
+    }
+
+    const uint8_t *centerEnd = src + length * srcStride;
+    while (right < centerEnd) {
+        storeAvx2(out, alphaSum, reciprocal);
+        loadAvx2(right, in);
+        loadAvx2(left, outgoing);
+        for (int i = 0; i < 4; ++i) {
+            alphaSum[i] = _mm256_sub_epi32(_mm256_add_epi32(alphaSum[i], in[i]), outgoing[i]);
+        }
+        left += srcStride;
+        right += srcStride;
+        out += dstStride;
+    }
+
+    const uint8_t *rightEnd = dst + length * dstStride;
+    while (out < rightEnd) {
+        storeAvx2(out, alphaSum, reciprocal);
+        loadAvx2(left, outgoing);
+        for (int i = 0; i < 4; ++i) {
+            alphaSum[i] = _mm256_sub_epi32(_mm256_add_epi32(alphaSum[i], lastValue[i]), outgoing[i]);
+        }
+        left += srcStride;
+        out += dstStride;
+    }
+}
+
+/**
+ * Transpose a 16x16 tile of 8-bit values.
+ *
+ * @param src The first value of the source tile.
+ * @param srcPixelStride The number of bytes between two values of one source row,
+ *    either 1 or 4. In the latter case the alpha values are taken from ARGB32 pixels.
+ * @param srcRowStride The number of bytes between two source rows.
+ * @param dst The destination tile.
+ * @param dstRowStride The number of bytes between two destination rows.
+ **/
+FLUENT_TARGET_SSE2
+static void transposeTileSse2(const uint8_t *src, int srcPixelStride, int srcRowStride,
+                              uint8_t *dst, int dstRowStride)
+{
+    __m128i rows[16];
+
+    if (srcPixelStride == 4) {
+        for (int i = 0; i < 16; ++i) {
+            const __m128i *pixels = reinterpret_cast<const __m128i *>(src + i * srcRowStride);
+            // The alpha offset is 3 on little endian, shift alpha down to the lowest byte.
+            const __m128i a = _mm_srli_epi32(_mm_loadu_si128(pixels), 24);
+            const __m128i b = _mm_srli_epi32(_mm_loadu_si128(pixels + 1), 24);
+            const __m128i c = _mm_srli_epi32(_mm_loadu_si128(pixels + 2), 24);
+            const __m128i d = _mm_srli_epi32(_mm_loadu_si128(pixels + 3), 24);
+            rows[i] = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+        }
+    } else {
+        for (int i = 0; i < 16; ++i) {
+            rows[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * srcRowStride));
+        }
+    }
+
+    // Four rounds of interleaving rows i and i + 8 transpose the tile.
+    for (int round = 0; round < 4; ++round) {
+        __m128i interleaved[16];
+        for (int i = 0; i < 8; ++i) {
+            interleaved[2 * i] = _mm_unpacklo_epi8(rows[i], rows[i + 8]);
+            interleaved[2 * i + 1] = _mm_unpackhi_epi8(rows[i], rows[i + 8]);
+        }
+        for (int i = 0; i < 16; ++i) {
+            rows[i] = interleaved[i];
+        }
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * dstRowStride), rows[i]);
+    }
+}
+
+#endif
+
+static BoxBlur::Kernel detectKernel()
+{
+#if FLUENT_BOXBLUR_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return BoxBlur::Avx2Kernel;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return BoxBlur::Sse2Kernel;
+    }
+#endif
+    return BoxBlur::ScalarKernel;
+}
+
+static BoxBlur::Kernel &currentKernel()
+{
+    static BoxBlur::Kernel kernel = detectKernel();
+    return kernel;
+}
+
+// The lobes of the three box filters, see BoxBlur::computeLobes(). The first
+// two filters put the larger lobe on opposite sides, so the blur stays centered.
+static constexpr int majorLobe(int blurRadius)
+{
+    return blurRadius / 3 + (blurRadius % 3 == 0 ? 0 : 1);
+}
+
+static constexpr int minorLobe(int blurRadius)
+{
+    return blurRadius / 3;
+}
+
+static constexpr int finalLobe(int blurRadius)
+{
+    return blurRadius / 3 + (blurRadius % 3 == 2 ? 1 : 0);
+}
+
+// The blur radii of the decoration and the style shadow presets, at device
+// pixel ratios of 1, 1.5, 2 and 3.
+static constexpr int s_presetBlurRadii[] = {
+    8, 11, 13, 14, 17, 21, 23, 25, 28, 34, 42,
+    45, 51, 56, 68, 85, 90, 102, 135, 180, 203, 271
+};
+
+// The box sizes the kernels are compiled for, they cover the presets above.
+#define FLUENT_PRESET_BOX_SIZES(X) \
+    X(6) X(7) X(8) X(9) X(10) X(11) X(12) X(13) X(15) X(16) X(17) \
+    X(18) X(19) X(20) X(23) X(24) X(29) X(31) X(35) X(38) X(39) X(46) \
+    X(47) X(57) X(58) X(61) X(69) X(91) X(121) X(136) X(137) X(181) X(182)
+
+#define FLUENT_BOX_SIZE_ITEM(size) size,
+static constexpr int s_specializedBoxSizes[] = { FLUENT_PRESET_BOX_SIZES(FLUENT_BOX_SIZE_ITEM) };
+#undef FLUENT_BOX_SIZE_ITEM
+
+static constexpr bool isSpecializedBoxSize(int boxSize, unsigned int i = 0)
+{
+    return i < sizeof(s_specializedBoxSizes) / sizeof(int)
+        && (s_specializedBoxSizes[i] == boxSize || isSpecializedBoxSize(boxSize, i + 1));
+}
+
+static constexpr bool coversPresets(unsigned int i = 0)
+{
+    return i == sizeof(s_presetBlurRadii) / sizeof(int)
+        || (isSpecializedBoxSize(majorLobe(s_presetBlurRadii[i]) + 1 + minorLobe(s_presetBlurRadii[i]))
+            && isSpecializedBoxSize(2 * finalLobe(s_presetBlurRadii[i]) + 1)
+            && coversPresets(i + 1));
+}
+
+static_assert(coversPresets(), "every preset box size must have specialized kernels");
+
+/**
+ * The kernels for one box size.
+ **/
+struct LaneKernels
+{
+    void (*scalar)(const uint8_t *, int, uint8_t *, int, int, int, const BoxLobes &);
+#if FLUENT_BOXBLUR_X86
+    void (*sse2)(const uint8_t *, int, uint8_t *, int, int, const BoxLobes &);
+    void (*avx2)(const uint8_t *, int, uint8_t *, int, int, const BoxLobes &);
+#endif
+};
+
+template<int FixedBoxSize>
+static LaneKernels laneKernels()
+{
+    LaneKernels kernels;
+    kernels.scalar = &blurLanesScalar<FixedBoxSize>;
+#if FLUENT_BOXBLUR_X86
+    kernels.sse2 = &blurLanesSse2<FixedBoxSize>;
+    kernels.avx2 = &blurLanesAvx2<FixedBoxSize>;
+#endif
+    return kernels;
+}
+
+static bool &specializationEnabled()
+{
+    static bool enabled = true;
+    return enabled;
+}
+
+/**
+ * The kernels compiled for the given box size, or the generic ones if the
+ * box size does not belong to a preset.
+ **/
+static LaneKernels specializedKernels(int boxSize)
+{
+    if (specializationEnabled()) {
+        switch (boxSize) {
+#define FLUENT_BOX_SIZE_CASE(size) case size: return laneKernels<size>();
+        FLUENT_PRESET_BOX_SIZES(FLUENT_BOX_SIZE_CASE)
+#undef FLUENT_BOX_SIZE_CASE
+        default:
+            break;
+        }
+    }
+    return laneKernels<0>();
+}
+
+/**
+ * Transpose a plane of 8-bit values, one cache-sized tile at a time.
+ *
+ * Value (x, y) is read from src[y * srcRowStride + x * srcPixelStride] and
+ * written to dst[x * dstRowStride + y].
+ *
+ * @param src The first value of the source plane.
+ * @param srcPixelStride The number of bytes between two values of one source row.
+ * @param srcRowStride The number of bytes between two source rows.
+ * @param dst The destination plane.
+ * @param dstRowStride The number of bytes between two destination rows.
+ * @param width The width of the source plane.
+ * @param height The height of the source plane.
+ **/
+static void transposeAlpha(const uint8_t *src, int srcPixelStride, int srcRowStride,
+                           uint8_t *dst, int dstRowStride, int width, int height)
+{
+    const int tileSize = 16;
+
+#if FLUENT_BOXBLUR_X86
+    const bool vectorized = currentKernel() != BoxBlur::ScalarKernel
+        && QSysInfo::ByteOrder == QSysInfo::LittleEndian
+        && (srcPixelStride == 1 || srcPixelStride == 4);
+#else
+    const bool vectorized = false;
+#endif
+
+    for (int tileY = 0; tileY < height; tileY += tileSize) {
+        const int tileHeight = qMin(tileSize, height - tileY);
+
+        for (int tileX = 0; tileX < width; tileX += tileSize) {
+            const int tileWidth = qMin(tileSize, width - tileX);
+
+            const uint8_t *in = src + tileY * srcRowStride + tileX * srcPixelStride;
+            uint8_t *out = dst + tileX * dstRowStride + tileY;
+
+#if FLUENT_BOXBLUR_X86
+            if (vectorized && tileWidth == tileSize && tileHeight == tileSize) {
+                // The alpha byte is the last one of a pixel, start the loads at the pixel.
+                transposeTileSse2(in - (srcPixelStride - 1), srcPixelStride, srcRowStride, out, dstRowStride);
+                continue;
+            }
+#else
+            Q_UNUSED(vectorized);
+#endif
+
+            for (int y = 0; y < tileHeight; ++y) {
+                const uint8_t *inRow = in + y * srcRowStride;
+                uint8_t *outColumn = out + y;
+                for (int x = 0; x < tileWidth; ++x, inRow += srcPixelStride, outColumn += dstRowStride) {
+                    *outColumn = *inRow;
+                }
+            }
+        }
+    }
+}
+
+BoxBlur::Kernel BoxBlur::kernel()
+{
+    return currentKernel();
+}
+
+void BoxBlur::setKernel(Kernel kernel)
+{
+    currentKernel() = isKernelSupported(kernel) ? kernel : ScalarKernel;
+}
+
+bool BoxBlur::isKernelSupported(Kernel kernel)
+{
+    switch (kernel) {
+    case ScalarKernel:
+        return true;
+#if FLUENT_BOXBLUR_X86
+    case Sse2Kernel:
+        return __builtin_cpu_supports("sse2");
+    case Avx2Kernel:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+QVector<BoxLobes> BoxBlur::computeLobes(int blurRadius)
+{
+    const int major = majorLobe(blurRadius);
+    const int minor = minorLobe(blurRadius);
+    const int final = finalLobe(blurRadius);
+
+    Q_ASSERT(major + minor + final == blurRadius);
+
+    QVector<BoxLobes> lobes(3);
+    lobes[0].left = major;
+    lobes[0].right = minor;
+    lobes[1].left = minor;
+    lobes[1].right = major;
+    lobes[2].left = final;
+    lobes[2].right = final;
+    return lobes;
+}
+
+void BoxBlur::setSpecializedKernelsEnabled(bool enabled)
+{
+    specializationEnabled() = enabled;
+}
+
+bool BoxBlur::specializedKernelsEnabled()
+{
+    return specializationEnabled();
+}
+
+void BoxBlur::blurLanes(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                        int length, int lanes, const BoxLobes &lobes)
+{
+    const int boxSize = lobes.left + 1 + lobes.right;
+    const LaneKernels kernels = specializedKernels(boxSize);
+    int lane = 0;
+
+#if FLUENT_BOXBLUR_X86
+    // The vector kernels never read past the end of a lane, short lanes are
+    // left to the scalar kernel to keep its exact behavior.
+    const Kernel kernel = currentKernel();
+    if (length >= boxSize && kernel == Avx2Kernel) {
+        for (; lane + 32 <= lanes; lane += 32) {
+            kernels.avx2(src + lane, srcStride, dst + lane, dstStride, length, lobes);
+        }
+    }
+    if (length >= boxSize && kernel != ScalarKernel) {
+        for (; lane + 16 <= lanes; lane += 16) {
+            kernels.sse2(src + lane, srcStride, dst + lane, dstStride, length, lobes);
+        }
+    }
+#endif
+
+    kernels.scalar(src + lane, srcStride, dst + lane, dstStride, length, lanes - lane, lobes);
+}
+
+// Planes with fewer pixels than this are blurred on the calling thread only,
+// waking up other threads would cost more than it saves.
+static const int s_parallelThreshold = 256 * 256;
+
+// The lanes handed to one thread, a multiple of the widest vector kernel.
+static const int s_laneGranularity = 32;
+
+/**
+ * A range of lanes of a plane, that gets the three box filters.
+ **/
+struct LaneRange
+{
+    uint8_t *plane;  ///< the input, and the output after the third filter
+    uint8_t *buffer; ///< scratch plane of the same size
+    int stride;
+    int length;
+    int first;
+    int count;
+    const QVector<BoxLobes> *lobes;
+};
+
+static void blurLaneRange(const LaneRange &range)
+{
+    uint8_t *plane = range.plane + range.first;
+    uint8_t *buffer = range.buffer + range.first;
+    const QVector<BoxLobes> &lobes = *range.lobes;
+
+    BoxBlur::blurLanes(plane, range.stride, buffer, range.stride, range.length, range.count, lobes[0]);
+    BoxBlur::blurLanes(buffer, range.stride, plane, range.stride, range.length, range.count, lobes[1]);
+    BoxBlur::blurLanes(plane, range.stride, buffer, range.stride, range.length, range.count, lobes[2]);
+}
+
+/**
+ * Run the three box filters over all the lanes of a plane.
+ *
+ * Lanes are independent from each other, large planes are split in ranges
+ * of lanes that are blurred on the global thread pool. The result is in
+ * @p buffer.
+ **/
+static void blurPlane(uint8_t *plane, uint8_t *buffer, int stride, int length, const QVector<BoxLobes> &lobes)
+{
+    const int lanes = stride;
+
+    int threads = 1;
+    if (lanes * length >= s_parallelThreshold) {
+        threads = qBound(1, QThread::idealThreadCount(), lanes / s_laneGranularity);
+    }
+
+    int rangeSize = (lanes + threads - 1) / threads;
+    rangeSize = (rangeSize + s_laneGranularity - 1) / s_laneGranularity * s_laneGranularity;
+
+    // The calling thread takes the first range itself. Waiting for the other
+    // futures runs them on this thread if the pool had no room for them, so
+    // this never deadlocks when called from the pool.
+    QVector<QFuture<void> > futures;
+    LaneRange range = { plane, buffer, stride, length, 0, qMin(rangeSize, lanes), &lobes };
+    for (int first = rangeSize; first < lanes; first += rangeSize) {
+        LaneRange other = range;
+        other.first = first;
+        other.count = qMin(rangeSize, lanes - first);
+        futures.append(QtConcurrent::run(blurLaneRange, other));
+    }
+
+    blurLaneRange(range);
+
+    for (int i = 0; i < futures.count(); ++i) {
+        futures[i].waitForFinished();
+    }
+}
+
+void BoxBlur::blurAlpha(QImage &image, const QVector<BoxLobes> &lobes, const QRect &rect)
+{
+    const QRect blurRect = rect.isNull() ? image.rect() : rect;
+
+    const int alphaOffset = image.depth() == 8 || QSysInfo::ByteOrder == QSysInfo::BigEndian ? 0 : 3;
+    const int width = blurRect.width();
+    const int height = blurRect.height();
+    const int rowStride = image.bytesPerLine();
+    const int pixelStride = image.depth() >> 3;
+
+    uint8_t *origin = image.scanLine(blurRect.y()) + blurRect.x() * pixelStride + alphaOffset;
+
+    // Work on a compact copy of the alpha channel rather than reading one byte
+    // out of every pixel. Both passes blur along the rows of a plane, with all
+    // the columns as lanes: the horizontal pass runs on the transposed plane.
+    const int planeSize = width * height;
+    QScopedPointer<uint8_t, QScopedPointerArrayDeleter<uint8_t> > buf(new uint8_t[2 * planeSize]);
+    uint8_t *buf1 = buf.data();
+    uint8_t *buf2 = buf1 + planeSize;
+
+    // Blur the image in horizontal direction.
+    transposeAlpha(origin, pixelStride, rowStride, buf1, height, width, height);
+    blurPlane(buf1, buf2, height, width, lobes);
+
+    // Blur the image in vertical direction.
+    transposeAlpha(buf2, 1, height, buf1, width, height, width);
+    blurPlane(buf1, buf2, width, height, lobes);
+
+    for (int y = 0; y < height; ++y) {
+        const uint8_t *in = buf2 + y * width;
+        uint8_t *out = origin + y * rowStride;
+        for (int x = 0; x < width; ++x, out += pixelStride) {
+            *out = in[x];
+        }
+    }
+}
+
+} // namespace Fluent
@@ -0,0 +1,131 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#pragma once
+
+// own
+#include "fluentcommon_export.h"
+
+// Qt
+#include <QImage>
+#include <QRect>
+#include <QVector>
+
+#include <stdint.h>
+
+namespace Fluent
+{
+
+struct BoxLobes
+{
+    int left;  ///< how many pixels sample to the left
+    int right; ///< how many pixels sample to the right
+};
+
+/**
+ * Triple box blur of 8-bit alpha values.
+ *
+ * The blur is computed on "lanes": a lane is one row or one column of alpha
+ * values, and the vectorized kernels advance several neighbouring lanes in
+ * lockstep, one running sum per lane. The kernel is picked at runtime from
+ * the instruction sets supported by the CPU, every kernel produces exactly
+ * the same output as the scalar one.
+ **/
+class FLUENTCOMMON_EXPORT BoxBlur
+{
+public:
+    enum Kernel {
+        ScalarKernel,
+        Sse2Kernel,
+        Avx2Kernel
+    };
+
+    /**
+     * The kernel that is used by blurLanes() and blurAlpha().
+     **/
+    static Kernel kernel();
+
+    /**
+     * Force the kernel, mostly useful for benchmarks and comparisons.
+     *
+     * If the kernel is not supported by the CPU, the scalar kernel is used.
+     * @param kernel The kernel to use.
+     **/
+    static void setKernel(Kernel kernel);
+
+    /**
+     * Whether the given kernel can run on this CPU.
+     * @param kernel The kernel.
+     **/
+    static bool isKernelSupported(Kernel kernel);
+
+    /**
+     * Enable or disable the kernels compiled for the box sizes of the
+     * shadow presets, mostly useful for benchmarks and comparisons.
+     *
+     * Both produce the same output, the generic kernels are used for other
+     * box sizes anyway.
+     * @param enabled Whether to use the specialized kernels.
+     **/
+    static void setSpecializedKernelsEnabled(bool enabled);
+
+    /**
+     * Whether the kernels compiled for the preset box sizes are used.
+     **/
+    static bool specializedKernelsEnabled();
+
+    /**
+     * Compute box filter parameters.
+     *
+     * @param blurRadius The radius of the whole (triple) box blur, in pixels.
+     * @returns Parameters for three box filters.
+     **/
+    static QVector<BoxLobes> computeLobes(int blurRadius);
+
+    /**
+     * Run one box filter over several lanes.
+     *
+     * Value @p i of lane @p k is read from src[i * srcStride + k] and written
+     * to dst[i * dstStride + k]. The source and the destination must not
+     * overlap.
+     *
+     * @param src The first value of the first lane.
+     * @param srcStride The number of bytes between two values of one lane.
+     * @param dst The destination.
+     * @param dstStride The number of bytes between two values of one output lane.
+     * @param length The number of values in each lane.
+     * @param lanes The number of lanes.
+     * @param lobes Params of the box filter.
+     **/
+    static void blurLanes(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                          int length, int lanes, const BoxLobes &lobes);
+
+    /**
+     * Blur the alpha channel of an image in place.
+     *
+     * The alpha channel is copied into a compact plane, and the horizontal
+     * pass runs on a transposed copy of it, so both passes walk memory
+     * sequentially. Large images are blurred on several threads.
+     *
+     * @param image The image, it must have either 32-bit pixels or 8-bit alpha values.
+     * @param lobes Params of the box filters, as returned by computeLobes().
+     * @param rect Specifies what part of the image to blur. If nothing is provided, then
+     *    the whole alpha channel of the input image will be blurred.
+     **/
+    static void blurAlpha(QImage &image, const QVector<BoxLobes> &lobes, const QRect &rect = QRect());
+};
+
+} // namespace Fluent
@@ -1,8 +1,6 @@
 /*
  * Copyright (C) 2018 Vlad Zagorodniy <vladzzag@gmail.com>
  *
- * The box blur implementation is based on AlphaBoxBlur from Firefox.
- *
  * This program is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
  * the Free Software Foundation; either version 2 of the License, or
@@ -20,12 +18,15 @@
 
 // own
 #include "fluentboxshadowrenderer.h"
+#include "fluentboxblur.h"
 
 // auto-generated
 #include "config-fluentcommon.h"
 
 // Qt
+#include <QDataStream>
 #include <QPainter>
+#include <QtConcurrentRun>
 
 #ifdef FLUENT_COMMON_USE_KDE4
 #include <QtCore/qmath.h>
@@ -33,6 +34,8 @@
 #include <QtMath>
 #endif
 
+#include <cmath>
+
 namespace Fluent
 {
 
@@ -55,227 +58,268 @@ static inline QSize calculateBlurExtent(int radius)
     return QSize(blurRadius, blurRadius);
 }
 
-struct BoxLobes
+void BoxShadowRenderer::boxBlurAlpha(QImage &image, int radius, const QRect &rect)
 {
-    int left;  ///< how many pixels sample to the left
-    int right; ///< how many pixels sample to the right
-};
-
-/**
- * Compute box filter parameters.
- *
- * @param radius The blur radius.
- * @returns Parameters for three box filters.
- **/
-static QVector<BoxLobes> computeLobes(int radius)
-{
-    const int blurRadius = calculateBlurRadius(calculateBlurStdDev(radius));
-    const int z = blurRadius / 3;
-
-    int major;
-    int minor;
-    int final;
-
-    switch (blurRadius % 3) {
-    case 0:
-        major = z;
-        minor = z;
-        final = z;
-        break;
-
-    case 1:
-        major = z + 1;
-        minor = z;
-        final = z;
-        break;
-
-    case 2:
-        major = z + 1;
-        minor = z;
-        final = z + 1;
-        break;
-
-    default:
-#if !FLUENT_COMMON_USE_KDE4
-        Q_UNREACHABLE();
-#endif
-        break;
+    if (radius < 2) {
+        return;
     }
 
-    Q_ASSERT(major + minor + final == blurRadius);
-
-    return {
-        {major, minor},
-        {minor, major},
-        {final, final}
-    };
+    const QVector<BoxLobes> lobes = BoxBlur::computeLobes(calculateBlurRadius(calculateBlurStdDev(radius)));
+    BoxBlur::blurAlpha(image, lobes, rect);
 }
 
-/**
- * Process a row with a box filter.
- *
- * @param src The start of the row.
- * @param dst The destination.
- * @param width The width of the row, in pixels.
- * @param horizontalStride The number of bytes from one alpha value to the
- *    next alpha value.
- * @param verticalStride The number of bytes from one row to the next row.
- * @param lobes Params of the box filter.
- * @param transposeInput Whether the input is transposed.
- * @param transposeOutput Whether the output should be transposed.
- **/
-static inline void boxBlurRowAlpha(const uint8_t *src, uint8_t *dst, int width, int horizontalStride,
-                                   int verticalStride, const BoxLobes &lobes, bool transposeInput,
-                                   bool transposeOutput)
+static inline int alphaOffset(const QImage &image)
 {
-    const int inputStep = transposeInput ? verticalStride : horizontalStride;
-    const int outputStep = transposeOutput ? verticalStride : horizontalStride;
-
-    const int boxSize = lobes.left + 1 + lobes.right;
-    const int reciprocal = (1 << 24) / boxSize;
+    if (image.depth() == 8) {
+        return 0;
+    }
+    return QSysInfo::ByteOrder == QSysInfo::BigEndian ? 0 : 3;
+}
 
-    uint32_t alphaSum = (boxSize + 1) / 2;
+void BoxShadowRenderer::mirrorTopLeftQuadrant(QImage &image)
+{
+    const int width = image.width();
+    const int height = image.height();
 
-    const uint8_t *left = src;
-    const uint8_t *right = src;
-    uint8_t *out = dst;
+    const int centerX = qCeil(width * 0.5);
+    const int centerY = qCeil(height * 0.5);
 
-    const uint8_t firstValue = src[0];
-    const uint8_t lastValue = src[(width - 1) * inputStep];
+    const int offset = alphaOffset(image);
+    const int stride = image.depth() >> 3;
 
-    alphaSum += firstValue * lobes.left;
+    for (int y = 0; y < centerY; ++y) {
+        uint8_t *in = image.scanLine(y) + offset;
+        uint8_t *out = in + (width - 1) * stride;
 
-    const uint8_t *initEnd = src + (boxSize - lobes.left) * inputStep;
-    while (right < initEnd) {
-        alphaSum += *right;
-        right += inputStep;
+        for (int x = 0; x < centerX; ++x, in += stride, out -= stride) {
+            *out = *in;
+        }
     }
 
-    const uint8_t *leftEnd = src + boxSize * inputStep;
-    while (right < leftEnd) {
-        *out = (alphaSum * reciprocal) >> 24;
-        alphaSum += *right - firstValue;
-        right += inputStep;
-        out += outputStep;
-    }
+    for (int y = 0; y < centerY; ++y) {
+        const uint8_t *in = image.scanLine(y) + offset;
+        uint8_t *out = image.scanLine(height - y - 1) + offset;
 
-    const uint8_t *centerEnd = src + width * inputStep;
-    while (right < centerEnd) {
-        *out = (alphaSum * reciprocal) >> 24;
-        alphaSum += *right - *left;
-        left += inputStep;
-        right += inputStep;
-        out += outputStep;
+        for (int x = 0; x < width; ++x, in += stride, out += stride) {
+            *out = *in;
+        }
     }
+}
 
-    const uint8_t *rightEnd = dst + width * outputStep;
-    while (out < rightEnd) {
-        *out = (alphaSum * reciprocal) >> 24;
-        alphaSum += lastValue - *left;
-        left += inputStep;
-        out += outputStep;
-    }
+static inline uint divideBy255(uint value)
+{
+    return (value + (value >> 8) + 0x80) >> 8;
 }
 
 /**
- * Blur the alpha channel of a given image.
+ * Composite a shadow mask over a premultiplied ARGB32 image.
  *
- * @param image The input image.
- * @param radius The blur radius.
- * @param rect Specifies what part of the image to blur. If nothing is provided, then
- *    the whole alpha channel of the input image will be blurred.
+ * @param canvas The destination image.
+ * @param mask The blurred shadow, only its alpha channel is used.
+ * @param topLeft Where the top-left corner of the mask lands, in device pixels.
+ * @param color The color of the shadow.
  **/
-static inline void boxBlurAlpha(QImage &image, int radius, const QRect &rect = {})
+static void compositeShadow(QImage &canvas, const QImage &mask, const QPoint &topLeft, const QColor &color)
 {
-    if (radius < 2) {
+    const QRect targetRect = QRect(topLeft, mask.size()) & canvas.rect();
+    if (targetRect.isEmpty()) {
         return;
     }
 
-    const QVector<BoxLobes> lobes = computeLobes(radius);
-
-    const QRect blurRect = rect.isNull() ? image.rect() : rect;
-
-    const int alphaOffset = QSysInfo::ByteOrder == QSysInfo::BigEndian ? 0 : 3;
-    const int width = blurRect.width();
-    const int height = blurRect.height();
-    const int rowStride = image.bytesPerLine();
-    const int pixelStride = image.depth() >> 3;
-
-    const int bufferStride = qMax(width, height) * pixelStride;
-    QScopedPointer<uint8_t, QScopedPointerArrayDeleter<uint8_t> > buf(new uint8_t[2 * bufferStride]);
-    uint8_t *buf1 = buf.data();
-    uint8_t *buf2 = buf1 + bufferStride;
-
-    // Blur the image in horizontal direction.
-    for (int i = 0; i < height; ++i) {
-        uint8_t *row = image.scanLine(blurRect.y() + i) + blurRect.x() * pixelStride + alphaOffset;
-        boxBlurRowAlpha(row, buf1, width, pixelStride, rowStride, lobes[0], false, false);
-        boxBlurRowAlpha(buf1, buf2, width, pixelStride, rowStride, lobes[1], false, false);
-        boxBlurRowAlpha(buf2, row, width, pixelStride, rowStride, lobes[2], false, false);
+    const uint red = color.red();
+    const uint green = color.green();
+    const uint blue = color.blue();
+    const uint alpha = color.alpha();
+
+    const int offset = alphaOffset(mask);
+    const int stride = mask.depth() >> 3;
+
+    for (int y = targetRect.top(); y <= targetRect.bottom(); ++y) {
+        const uint8_t *in = mask.constScanLine(y - topLeft.y()) + (targetRect.left() - topLeft.x()) * stride + offset;
+        QRgb *out = reinterpret_cast<QRgb *>(canvas.scanLine(y)) + targetRect.left();
+
+        for (int x = targetRect.left(); x <= targetRect.right(); ++x, in += stride, ++out) {
+            const uint a = divideBy255(*in * alpha);
+            if (!a) {
+                continue;
+            }
+
+            const uint inverse = 255 - a;
+            const QRgb dst = *out;
+            *out = qRgba(divideBy255(red * a) + divideBy255(qRed(dst) * inverse),
+                         divideBy255(green * a) + divideBy255(qGreen(dst) * inverse),
+                         divideBy255(blue * a) + divideBy255(qBlue(dst) * inverse),
+                         a + divideBy255(qAlpha(dst) * inverse));
+        }
     }
+}
 
-    // Blur the image in vertical direction.
-    for (int i = 0; i < width; ++i) {
-        uint8_t *column = image.scanLine(blurRect.y()) + (blurRect.x() + i) * pixelStride + alphaOffset;
-        boxBlurRowAlpha(column, buf1, height, pixelStride, rowStride, lobes[0], true, false);
-        boxBlurRowAlpha(buf1, buf2, height, pixelStride, rowStride, lobes[1], false, false);
-        boxBlurRowAlpha(buf2, column, height, pixelStride, rowStride, lobes[2], false, true);
-    }
+/**
+ * Where the top-left corner of a shadow mask lands on the texture.
+ *
+ * @param mask The shadow mask.
+ * @param boxRect The box, in logical pixels of the texture.
+ * @param offset The offset of the shadow.
+ * @param dpr The device pixel ratio.
+ * @returns The position of the mask, in device pixels.
+ **/
+static inline QPoint maskPosition(const QImage &mask, const QRect &boxRect, const QPoint &offset, qreal dpr)
+{
+    QRect shadowRect(QPoint(0, 0), mask.size() / dpr);
+    shadowRect.moveCenter(boxRect.center() + offset);
+    return QPoint(qRound(shadowRect.x() * dpr), qRound(shadowRect.y() * dpr));
 }
 
-static inline void mirrorTopLeftQuadrant(QImage &image)
+/**
+ * The integral of a normalized Gaussian over [from, to], seen from a pixel.
+ *
+ * @param position The center of the pixel.
+ * @param from The start of the interval.
+ * @param to The end of the interval.
+ * @param scale The standard deviation of the Gaussian, times sqrt(2).
+ **/
+static inline float gaussianInterval(float position, float from, float to, float scale)
 {
-    const int width = image.width();
-    const int height = image.height();
+    return 0.5f * (std::erf((position - from) / scale) - std::erf((position - to) / scale));
+}
 
-    const int centerX = qCeil(width * 0.5);
-    const int centerY = qCeil(height * 0.5);
+/**
+ * Evaluate the top-left quadrant of a Gaussian blurred rounded rect.
+ *
+ * The straight part of the box is separable, its contribution is the product
+ * of a row profile and a column profile. The corners are cut in horizontal
+ * slices, each slice is a rect with its own inset and adds the product of its
+ * own row and column profiles. That keeps the number of erf() evaluations
+ * proportional to the width and height of the texture rather than to its area.
+ *
+ * @param image The 8-bit alpha mask to fill.
+ * @param boxRect The box, in device pixels.
+ * @param cornerRadius The radius of the corners of the box, in device pixels.
+ * @param sigma The standard deviation of the blur, in device pixels.
+ **/
+static void renderGaussianQuadrant(QImage &image, const QRectF &boxRect, qreal cornerRadius, qreal sigma)
+{
+    const int width = qCeil(image.width() * 0.5);
+    const int height = qCeil(image.height() * 0.5);
+
+    const float scale = sigma * M_SQRT2;
+    const float left = boxRect.left();
+    const float right = boxRect.right();
+    const float top = boxRect.top();
+    const float bottom = boxRect.bottom();
+    const float radius = qBound(qreal(0), cornerRadius, qMin(boxRect.width(), boxRect.height()) * 0.5);
+
+    const int sliceCount = radius > 0 ? qMax(1, qCeil(radius)) : 0;
+    const float sliceHeight = sliceCount ? radius / sliceCount : 0;
+
+    // column profiles: the straight part first, then one per corner slice
+    QVector<float> columns((sliceCount + 1) * width);
+    // row profiles, each corner slice also covers its mirror at the bottom
+    QVector<float> rows((sliceCount + 1) * height);
+
+    for (int x = 0; x < width; ++x) {
+        columns[x] = gaussianInterval(x + 0.5f, left, right, scale);
+    }
+    for (int y = 0; y < height; ++y) {
+        rows[y] = gaussianInterval(y + 0.5f, top + radius, bottom - radius, scale);
+    }
 
-    const int alphaOffset = QSysInfo::ByteOrder == QSysInfo::BigEndian ? 0 : 3;
-    const int stride = image.depth() >> 3;
+    for (int i = 0; i < sliceCount; ++i) {
+        const float sliceTop = top + i * sliceHeight;
+        const float sliceBottom = sliceTop + sliceHeight;
+        const float dy = top + radius - (sliceTop + sliceBottom) * 0.5f;
+        const float inset = radius - std::sqrt(qMax(0.0f, radius * radius - dy * dy));
 
-    for (int y = 0; y < centerY; ++y) {
-        uint8_t *in = image.scanLine(y) + alphaOffset;
-        uint8_t *out = in + (width - 1) * stride;
+        float *column = columns.data() + (i + 1) * width;
+        for (int x = 0; x < width; ++x) {
+            column[x] = gaussianInterval(x + 0.5f, left + inset, right - inset, scale);
+        }
 
-        for (int x = 0; x < centerX; ++x, in += stride, out -= stride) {
-            *out = *in;
+        float *row = rows.data() + (i + 1) * height;
+        for (int y = 0; y < height; ++y) {
+            row[y] = gaussianInterval(y + 0.5f, sliceTop, sliceBottom, scale)
+                + gaussianInterval(y + 0.5f, bottom - sliceHeight * (i + 1), bottom - sliceHeight * i, scale);
         }
     }
 
-    for (int y = 0; y < centerY; ++y) {
-        const uint8_t *in = image.scanLine(y) + alphaOffset;
-        uint8_t *out = image.scanLine(width - y - 1) + alphaOffset;
+    QVector<float> line(width);
+    for (int y = 0; y < height; ++y) {
+        const float straight = rows[y];
+        for (int x = 0; x < width; ++x) {
+            line[x] = columns[x] * straight;
+        }
 
-        for (int x = 0; x < width; ++x, in += stride, out += stride) {
-            *out = *in;
+        for (int i = 1; i <= sliceCount; ++i) {
+            const float weight = rows[i * height + y];
+            if (weight < 1e-6f) {
+                continue;
+            }
+            const float *column = columns.constData() + i * width;
+            for (int x = 0; x < width; ++x) {
+                line[x] += column[x] * weight;
+            }
+        }
+
+        uint8_t *out = image.scanLine(y);
+        const int stride = image.depth() >> 3;
+        out += alphaOffset(image);
+        for (int x = 0; x < width; ++x, out += stride) {
+            *out = qBound(0, qRound(line[x] * 255.0f), 255);
         }
     }
 }
 
-static void renderShadow(QPainter *painter, const QRect &rect, qreal borderRadius, const QPoint &offset, int radius, const QColor &color)
+/**
+ * Render the blurred alpha mask of one shadow.
+ *
+ * @param engine The engine that renders the shadow.
+ * @param boxSize The size of the box, in logical pixels.
+ * @param borderRadius The border radius of the box.
+ * @param radius The blur radius.
+ * @param dpr The device pixel ratio.
+ **/
+static QImage renderShadowMask(BoxShadowRenderer::Engine engine, const QSize &boxSize, qreal borderRadius, int radius, qreal dpr)
 {
     const QSize inflation = calculateBlurExtent(radius);
-    const QSize size = rect.size() + 2 * inflation;
+    const QSize size = boxSize + 2 * inflation;
 
 #if FLUENT_COMMON_USE_KDE4
-    const qreal dpr = 1.0;
-#else
-    const qreal dpr = painter->device()->devicePixelRatioF();
-#endif
-
     QImage shadow(size * dpr, QImage::Format_ARGB32_Premultiplied);
-#if !FLUENT_COMMON_USE_KDE4
+#else
+    QImage shadow(size * dpr, QImage::Format_Alpha8);
     shadow.setDevicePixelRatio(dpr);
 #endif
     shadow.fill(Qt::transparent);
 
-    QRect boxRect(QPoint(0, 0), rect.size());
+    QRect boxRect(QPoint(0, 0), boxSize);
     boxRect.moveCenter(QRect(QPoint(0, 0), size).center());
 
     const qreal xRadius = 2.0 * borderRadius / boxRect.width();
     const qreal yRadius = 2.0 * borderRadius / boxRect.height();
 
+    const int scaledRadius = qRound(radius * dpr);
+
+    if (engine == BoxShadowRenderer::GaussianEngine && scaledRadius >= 2) {
+        // Use the variance of the three box filters, so both engines agree on
+        // how wide the shadow is, and the same corners as the rasterized box.
+        const QVector<BoxLobes> lobes = BoxBlur::computeLobes(calculateBlurRadius(calculateBlurStdDev(scaledRadius)));
+        qreal variance = 0;
+#if FLUENT_COMMON_USE_KDE4
+        foreach (const BoxLobes &lobe, lobes) {
+#else
+        for (const BoxLobes &lobe : lobes) {
+#endif
+            const int boxWidth = lobe.left + 1 + lobe.right;
+            variance += (boxWidth * boxWidth - 1) / 12.0;
+        }
+
+        const QRectF deviceBoxRect(boxRect.x() * dpr, boxRect.y() * dpr, boxRect.width() * dpr, boxRect.height() * dpr);
+        renderGaussianQuadrant(shadow, deviceBoxRect, qMin(xRadius, yRadius) * dpr, qSqrt(variance));
+        BoxShadowRenderer::mirrorTopLeftQuadrant(shadow);
+
+        return shadow;
+    }
+
     QPainter shadowPainter;
     shadowPainter.begin(&shadow);
     shadowPainter.setRenderHint(QPainter::Antialiasing);
@@ -287,21 +331,15 @@ static void renderShadow(QPainter *painter, const QRect &rect, qreal borderRadiu
     // Because the shadow texture is symmetrical, that's enough to blur
     // only the top-left quadrant and then mirror it.
     const QRect blurRect(0, 0, qCeil(shadow.width() * 0.5), qCeil(shadow.height() * 0.5));
-    const int scaledRadius = qRound(radius * dpr);
-    boxBlurAlpha(shadow, scaledRadius, blurRect);
-    mirrorTopLeftQuadrant(shadow);
+    BoxShadowRenderer::boxBlurAlpha(shadow, scaledRadius, blurRect);
+    BoxShadowRenderer::mirrorTopLeftQuadrant(shadow);
 
-    // Give the shadow a tint of the desired color.
-    shadowPainter.begin(&shadow);
-    shadowPainter.setCompositionMode(QPainter::CompositionMode_SourceIn);
-    shadowPainter.fillRect(shadow.rect(), color);
-    shadowPainter.end();
+    return shadow;
+}
 
-    // Actually, present the shadow.
-    QRect shadowRect = shadow.rect();
-    shadowRect.setSize(shadowRect.size() / dpr);
-    shadowRect.moveCenter(rect.center() + offset);
-    painter->drawImage(shadowRect, shadow);
+void BoxShadowRenderer::setEngine(Engine engine)
+{
+    m_engine = engine;
 }
 
 void BoxShadowRenderer::setBoxSize(const QSize &size)
@@ -334,15 +372,7 @@ QImage BoxShadowRenderer::render() const
         return {};
     }
 
-    QSize canvasSize;
-#if FLUENT_COMMON_USE_KDE4
-    foreach (const Shadow &shadow, m_shadows) {
-#else
-    for (const Shadow &shadow : qAsConst(m_shadows)) {
-#endif
-        canvasSize = canvasSize.expandedTo(
-            calculateMinimumShadowTextureSize(m_boxSize, shadow.radius, shadow.offset));
-    }
+    const QSize canvasSize = textureSize();
 
     QImage canvas(canvasSize * m_dpr, QImage::Format_ARGB32_Premultiplied);
 #if !FLUENT_COMMON_USE_KDE4
@@ -353,19 +383,112 @@ QImage BoxShadowRenderer::render() const
     QRect boxRect(QPoint(0, 0), m_boxSize);
     boxRect.moveCenter(QRect(QPoint(0, 0), canvasSize).center());
 
-    QPainter painter(&canvas);
+    // The shadows are rendered and blurred as plain alpha masks, they get
+    // their color only when they are composited onto the canvas.
 #if FLUENT_COMMON_USE_KDE4
     foreach (const Shadow &shadow, m_shadows) {
 #else
     for (const Shadow &shadow : qAsConst(m_shadows)) {
 #endif
-        renderShadow(&painter, boxRect, m_borderRadius, shadow.offset, shadow.radius, shadow.color);
+        const QImage mask = renderShadowMask(m_engine, m_boxSize, m_borderRadius, shadow.radius, m_dpr);
+        compositeShadow(canvas, mask, maskPosition(mask, boxRect, shadow.offset, m_dpr), shadow.color);
     }
-    painter.end();
 
     return canvas;
 }
 
+QFuture<QImage> BoxShadowRenderer::renderAsync() const
+{
+    return QtConcurrent::run(*this, &BoxShadowRenderer::render);
+}
+
+QVector<QImage> BoxShadowRenderer::renderTiles() const
+{
+    if (m_shadows.isEmpty()) {
+        return {};
+    }
+
+    const QRect outerRect(QPoint(0, 0), textureSize());
+    const QPoint center = outerRect.center();
+
+    QRect boxRect(QPoint(0, 0), m_boxSize);
+    boxRect.moveCenter(center);
+
+    QVector<QImage> masks;
+    QVector<QPoint> positions;
+#if FLUENT_COMMON_USE_KDE4
+    foreach (const Shadow &shadow, m_shadows) {
+#else
+    for (const Shadow &shadow : qAsConst(m_shadows)) {
+#endif
+        const QImage mask = renderShadowMask(m_engine, m_boxSize, m_borderRadius, shadow.radius, m_dpr);
+        positions.append(maskPosition(mask, boxRect, shadow.offset, m_dpr));
+        masks.append(mask);
+    }
+
+    const int columns[] = { 0, center.x(), center.x() + 1, outerRect.width() };
+    const int rows[] = { 0, center.y(), center.y() + 1, outerRect.height() };
+
+    QVector<QImage> tiles;
+    tiles.reserve(9);
+
+    for (int row = 0; row < 3; ++row) {
+        for (int column = 0; column < 3; ++column) {
+            const QRect tileRect(QPoint(columns[column], rows[row]),
+                                 QPoint(columns[column + 1] - 1, rows[row + 1] - 1));
+            const QPoint origin(qRound(tileRect.x() * m_dpr), qRound(tileRect.y() * m_dpr));
+
+            QImage tile(tileRect.size() * m_dpr, QImage::Format_ARGB32_Premultiplied);
+#if !FLUENT_COMMON_USE_KDE4
+            tile.setDevicePixelRatio(m_dpr);
+#endif
+            tile.fill(Qt::transparent);
+
+            for (int i = 0; i < masks.count(); ++i) {
+                compositeShadow(tile, masks.at(i), positions.at(i) - origin, m_shadows.at(i).color);
+            }
+
+            tiles.append(tile);
+        }
+    }
+
+    return tiles;
+}
+
+QSize BoxShadowRenderer::textureSize() const
+{
+    QSize size;
+#if FLUENT_COMMON_USE_KDE4
+    foreach (const Shadow &shadow, m_shadows) {
+#else
+    for (const Shadow &shadow : qAsConst(m_shadows)) {
+#endif
+        size = size.expandedTo(
+            calculateMinimumShadowTextureSize(m_boxSize, shadow.radius, shadow.offset));
+    }
+    return size;
+}
+
+QByteArray BoxShadowRenderer::cacheKey() const
+{
+    QByteArray key;
+    QDataStream stream(&key, QIODevice::WriteOnly);
+    stream << int(m_engine) << m_boxSize << m_borderRadius << m_dpr << m_shadows.count();
+#if FLUENT_COMMON_USE_KDE4
+    foreach (const Shadow &shadow, m_shadows) {
+#else
+    for (const Shadow &shadow : qAsConst(m_shadows)) {
+#endif
+        stream << shadow.offset << shadow.radius << shadow.color.rgba();
+    }
+    return key;
+}
+
+int BoxShadowRenderer::version()
+{
+    return 1;
+}
+
 QSize BoxShadowRenderer::calculateMinimumBoxSize(int radius)
 {
     const QSize blurExtent = calculateBlurExtent(radius);
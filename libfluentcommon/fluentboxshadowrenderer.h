@@ -22,10 +22,14 @@
 #include "fluentcommon_export.h"
 
 // Qt
+#include <QByteArray>
 #include <QColor>
+#include <QFuture>
 #include <QImage>
 #include <QPoint>
+#include <QRect>
 #include <QSize>
+#include <QVector>
 
 namespace Fluent
 {
@@ -35,6 +39,25 @@ class FLUENTCOMMON_EXPORT BoxShadowRenderer
 public:
     // Compiler generated constructors & destructor are fine.
 
+    enum Engine {
+        /**
+         * Rasterize the box and blur it with a triple box blur.
+         **/
+        BoxBlurEngine,
+
+        /**
+         * Evaluate the Gaussian blurred box directly, with a closed form
+         * built from error functions.
+         **/
+        GaussianEngine
+    };
+
+    /**
+     * Set the engine that renders the shadows.
+     * @param engine The shadow engine.
+     **/
+    void setEngine(Engine engine);
+
     /**
      * Set the size of the box.
      * @param size The size of the box.
@@ -66,6 +89,45 @@ public:
      **/
     QImage render() const;
 
+    /**
+     * Render the shadow on the global thread pool.
+     *
+     * The renderer is copied, it can be modified or destroyed right away.
+     * @returns The future shadow texture, see render().
+     **/
+    QFuture<QImage> renderAsync() const;
+
+    /**
+     * Render the shadow as nine separate tiles.
+     *
+     * The texture is split around its center, the middle row and the middle
+     * column are 1 pixel wide. The tiles are ordered like in a nine-patch:
+     * top-left, top, top-right, left, center, right, bottom-left, bottom
+     * and bottom-right. Each tile is rendered directly, without going through
+     * a texture of the full size.
+     **/
+    QVector<QImage> renderTiles() const;
+
+    /**
+     * The size of the shadow texture, in logical pixels.
+     **/
+    QSize textureSize() const;
+
+    /**
+     * A key that identifies the rendered shadow.
+     *
+     * Two renderers with the same key render the same shadow.
+     **/
+    QByteArray cacheKey() const;
+
+    /**
+     * The version of the rendering code.
+     *
+     * It is bumped whenever a change makes the renderer output different
+     * pixels, so shadows stored by older versions are not used anymore.
+     **/
+    static int version();
+
     /**
      * Calculate the minimum size of the box.
      *
@@ -88,7 +150,28 @@ public:
      **/
     static QSize calculateMinimumShadowTextureSize(const QSize &boxSize, int radius, const QPoint &offset);
 
+    /**
+     * Blur the alpha channel of a given image, like the box blur engine does.
+     *
+     * This and mirrorTopLeftQuadrant() are the building blocks of render(),
+     * they are exposed for benchmarks and correctness checks.
+     *
+     * @param image The input image.
+     * @param radius The blur radius, in device pixels.
+     * @param rect Specifies what part of the image to blur. If nothing is provided, then
+     *    the whole alpha channel of the input image will be blurred.
+     **/
+    static void boxBlurAlpha(QImage &image, int radius, const QRect &rect = QRect());
+
+    /**
+     * Copy the alpha channel of the top-left quadrant of an image into the
+     * three other quadrants, mirrored.
+     * @param image The image.
+     **/
+    static void mirrorTopLeftQuadrant(QImage &image);
+
 private:
+    Engine m_engine = BoxBlurEngine;
     QSize m_boxSize;
     qreal m_borderRadius = 0.0;
     qreal m_dpr = 1.0;
@@ -0,0 +1,274 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// own
+#include "fluentshadowcache.h"
+#include "fluentboxshadowrenderer.h"
+
+// auto-generated
+#include "config-fluentcommon.h"
+
+// Qt
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QThread>
+#include <QWaitCondition>
+
+namespace Fluent
+{
+
+// Enough for the largest decoration shadow at 3x, plus the menu shadow.
+static const int s_defaultMaxCost = 32 * 1024 * 1024;
+
+// The disk cache is written once no texture has been added for this many
+// milliseconds, shadows tend to be rendered in bursts.
+static const qint64 s_writeDelay = 3000;
+
+static int imageCost(const QVector<QImage> &images)
+{
+    int cost = 0;
+#if FLUENT_COMMON_USE_KDE4
+    foreach (const QImage &image, images) {
+#else
+    for (const QImage &image : images) {
+#endif
+        cost += image.byteCount();
+    }
+    return cost;
+}
+
+// Flushes the disk cache in the background, so the threads that insert
+// textures never wait for the disk.
+class ShadowCache::Writer : public QThread
+{
+public:
+    explicit Writer(ShadowDiskCache *diskCache)
+        : m_diskCache(diskCache)
+    {
+    }
+
+    // Write the disk cache once no other texture is added for a while.
+    void schedule()
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_stopping) {
+            return;
+        }
+
+        m_scheduled = true;
+        m_lastInsert.start();
+        if (!isRunning()) {
+            start(QThread::LowestPriority);
+        }
+        m_condition.wakeOne();
+    }
+
+    // Stop the thread, pending textures are not written.
+    void stop()
+    {
+        {
+            QMutexLocker locker(&m_mutex);
+            m_stopping = true;
+            m_condition.wakeOne();
+        }
+        wait();
+    }
+
+protected:
+    void run() override
+    {
+        QMutexLocker locker(&m_mutex);
+        while (!m_stopping) {
+            if (!m_scheduled) {
+                m_condition.wait(&m_mutex);
+                continue;
+            }
+
+            const qint64 remaining = s_writeDelay - m_lastInsert.elapsed();
+            if (remaining > 0) {
+                m_condition.wait(&m_mutex, static_cast<unsigned long>(remaining));
+                continue;
+            }
+
+            m_scheduled = false;
+            locker.unlock();
+            m_diskCache->flush();
+            locker.relock();
+        }
+    }
+
+private:
+    ShadowDiskCache *m_diskCache;
+
+    QMutex m_mutex;
+    QWaitCondition m_condition;
+    QElapsedTimer m_lastInsert;
+    bool m_scheduled = false;
+    bool m_stopping = false;
+};
+
+ShadowCache::ShadowCache()
+    : m_diskCache(ShadowDiskCache::defaultFileName())
+{
+    m_cache.setMaxCost(s_defaultMaxCost);
+}
+
+ShadowCache::~ShadowCache()
+{
+    // This runs during static destruction, do not block the exit on the
+    // disk: textures that are still pending are not written.
+    if (m_writer) {
+        m_writer->stop();
+    }
+}
+
+ShadowCache *ShadowCache::self()
+{
+    static ShadowCache cache;
+    return &cache;
+}
+
+QImage ShadowCache::texture(const BoxShadowRenderer &renderer)
+{
+    const QVector<QImage> images = lookup(renderer.cacheKey() + 'T', renderer, false);
+    return images.isEmpty() ? QImage() : images.first();
+}
+
+bool ShadowCache::containsTexture(const BoxShadowRenderer &renderer) const
+{
+    const QByteArray key = renderer.cacheKey() + 'T';
+
+    QMutexLocker locker(&m_mutex);
+    return m_cache.contains(key) || m_diskCache.contains(key);
+}
+
+void ShadowCache::insertTexture(const BoxShadowRenderer &renderer, const QImage &texture)
+{
+    insert(renderer.cacheKey() + 'T', QVector<QImage>() << texture);
+}
+
+QVector<QImage> ShadowCache::tiles(const BoxShadowRenderer &renderer)
+{
+    return lookup(renderer.cacheKey() + 'N', renderer, true);
+}
+
+QVector<QImage> ShadowCache::lookup(const QByteArray &key, const BoxShadowRenderer &renderer, bool tiles)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (const QVector<QImage> *images = m_cache.object(key)) {
+            ++m_hits;
+            return *images;
+        }
+
+        const QVector<QImage> images = m_diskCache.find(key);
+        if (!images.isEmpty()) {
+            ++m_diskHits;
+            m_cache.insert(key, new QVector<QImage>(images), imageCost(images));
+            return images;
+        }
+
+        ++m_misses;
+    }
+
+    // Render outside of the lock, the worst that can happen is that two
+    // threads render the same shadow.
+    QVector<QImage> images;
+    if (tiles) {
+        images = renderer.renderTiles();
+    } else {
+        images.append(renderer.render());
+    }
+
+    insert(key, images);
+    return images;
+}
+
+void ShadowCache::insert(const QByteArray &key, const QVector<QImage> &images)
+{
+    Writer *writer = nullptr;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_cache.insert(key, new QVector<QImage>(images), imageCost(images));
+        if (!m_diskCacheWritable) {
+            return;
+        }
+
+        m_diskCache.insert(key, images);
+        if (!m_writer) {
+            m_writer.reset(new Writer(&m_diskCache));
+        }
+        writer = m_writer.data();
+    }
+
+    writer->schedule();
+}
+
+void ShadowCache::setDiskCacheWritable(bool value)
+{
+    QMutexLocker locker(&m_mutex);
+    m_diskCacheWritable = value;
+}
+
+bool ShadowCache::isDiskCacheWritable() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_diskCacheWritable;
+}
+
+void ShadowCache::setMaxCost(int bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_cache.setMaxCost(bytes);
+}
+
+int ShadowCache::maxCost() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_cache.maxCost();
+}
+
+int ShadowCache::totalCost() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_cache.totalCost();
+}
+
+int ShadowCache::hits() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_hits;
+}
+
+int ShadowCache::diskHits() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_diskHits;
+}
+
+int ShadowCache::misses() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_misses;
+}
+
+void ShadowCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_cache.clear();
+}
+
+} // namespace Fluent
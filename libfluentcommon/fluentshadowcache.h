@@ -0,0 +1,158 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#pragma once
+
+// own
+#include "fluentcommon_export.h"
+#include "fluentshadowdiskcache.h"
+
+// Qt
+#include <QByteArray>
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+#include <QScopedPointer>
+#include <QVector>
+
+namespace Fluent
+{
+
+class BoxShadowRenderer;
+
+/**
+ * Process-wide cache of rendered shadow textures.
+ *
+ * The widget style and the window decoration both live in kwin and render
+ * the same shadows. The cache is keyed by every parameter of the renderer,
+ * and hands out implicitly shared images, so a shadow is rendered once per
+ * process, and not again after every reconfiguration.
+ *
+ * The least recently used textures are dropped when the cache grows past
+ * its budget. Textures are also looked up in a ShadowDiskCache, so a
+ * process reads the shadows another one rendered instead of rendering
+ * them. Only processes that turn on setDiskCacheWritable(), kwin through
+ * the window decoration, add their textures to it. The disk cache is then
+ * written by a background thread, once no texture has been added for a few
+ * seconds. Textures still pending at exit are not written.
+ **/
+class FLUENTCOMMON_EXPORT ShadowCache
+{
+public:
+    /**
+     * The singleton.
+     **/
+    static ShadowCache *self();
+
+    /**
+     * The shadow texture for the given renderer, see BoxShadowRenderer::render().
+     * @param renderer The renderer, it is only used on cache misses.
+     **/
+    QImage texture(const BoxShadowRenderer &renderer);
+
+    /**
+     * Whether the shadow texture for the given renderer is cached, either
+     * in memory or on disk.
+     * @param renderer The renderer.
+     **/
+    bool containsTexture(const BoxShadowRenderer &renderer) const;
+
+    /**
+     * Add a shadow texture that was rendered elsewhere, for example with
+     * BoxShadowRenderer::renderAsync().
+     *
+     * This does no disk I/O, it can be called from the GUI thread.
+     * @param renderer The renderer that rendered the texture.
+     * @param texture The shadow texture.
+     **/
+    void insertTexture(const BoxShadowRenderer &renderer, const QImage &texture);
+
+    /**
+     * The shadow tiles for the given renderer, see BoxShadowRenderer::renderTiles().
+     * @param renderer The renderer, it is only used on cache misses.
+     **/
+    QVector<QImage> tiles(const BoxShadowRenderer &renderer);
+
+    /**
+     * Set whether rendered textures are written to the disk cache, off by
+     * default. The first texture added starts the thread that writes it.
+     * @param value Whether the disk cache is written.
+     **/
+    void setDiskCacheWritable(bool value);
+
+    /**
+     * Whether rendered textures are written to the disk cache.
+     **/
+    bool isDiskCacheWritable() const;
+
+    /**
+     * Set the memory budget of the cache.
+     * @param bytes The budget, in bytes.
+     **/
+    void setMaxCost(int bytes);
+
+    /**
+     * The memory budget of the cache, in bytes.
+     **/
+    int maxCost() const;
+
+    /**
+     * The number of bytes used by the cached textures.
+     **/
+    int totalCost() const;
+
+    /**
+     * How many times a texture was found in the cache.
+     **/
+    int hits() const;
+
+    /**
+     * How many times a texture was found in the disk cache.
+     **/
+    int diskHits() const;
+
+    /**
+     * How many times a texture had to be rendered.
+     **/
+    int misses() const;
+
+    /**
+     * Drop all the cached textures.
+     **/
+    void clear();
+
+private:
+    ShadowCache();
+    ~ShadowCache();
+    Q_DISABLE_COPY(ShadowCache)
+
+    class Writer;
+
+    QVector<QImage> lookup(const QByteArray &key, const BoxShadowRenderer &renderer, bool tiles);
+    void insert(const QByteArray &key, const QVector<QImage> &images);
+
+    mutable QMutex m_mutex;
+
+    QCache<QByteArray, QVector<QImage> > m_cache;
+    ShadowDiskCache m_diskCache;
+    QScopedPointer<Writer> m_writer;
+    bool m_diskCacheWritable = false;
+    int m_hits = 0;
+    int m_diskHits = 0;
+    int m_misses = 0;
+};
+
+} // namespace Fluent
@@ -0,0 +1,568 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// own
+#include "fluentshadowdiskcache.h"
+#include "fluentboxshadowrenderer.h"
+
+// auto-generated
+#include "config-fluentcommon.h"
+
+// Qt
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Fluent
+{
+
+// The layout of the file. All the fields are in host byte order, a file
+// written on a machine with another byte order fails the magic check.
+//
+//   FileHeader
+//   IndexEntry * entryCount
+//   entry data, every entry starts on a 16 byte boundary:
+//     (ImageHeader, pixels) * imageCount, every image starts on a 16 byte boundary
+
+static const quint32 s_magic = 0x43534c46; // "FLSC"
+static const quint32 s_formatVersion = 1;
+static const int s_alignment = 16;
+static const int s_hashSize = 16;
+
+// The oldest entries are dropped when the file would grow past this size.
+static const quint32 s_maxFileSize = 16 * 1024 * 1024;
+
+struct FileHeader {
+    quint32 magic;
+    quint32 formatVersion;
+    quint32 rendererVersion;
+    quint32 fileSize;
+    quint32 entryCount;
+    quint32 indexChecksum;
+    quint32 reserved[2];
+};
+
+struct IndexEntry {
+    char hash[s_hashSize];
+    quint32 offset;
+    quint32 size;
+    quint32 checksum;
+    quint32 imageCount;
+};
+
+struct ImageHeader {
+    quint32 width;
+    quint32 height;
+    quint32 format;
+    quint32 bytesPerLine;
+    double devicePixelRatio;
+};
+
+static quint32 align(quint32 size)
+{
+    return (size + s_alignment - 1) & ~quint32(s_alignment - 1);
+}
+
+// FNV-1a over 32-bit words, every checksummed block is a multiple of 4 bytes.
+static quint32 checksum(const uchar *data, quint32 size)
+{
+    quint32 hash = 2166136261u;
+    for (quint32 i = 0; i + 4 <= size; i += 4) {
+        quint32 word;
+        memcpy(&word, data + i, 4);
+        hash = (hash ^ word) * 16777619u;
+    }
+    return hash;
+}
+
+// The size of the images once serialized, see ShadowDiskCache::serialize().
+static quint64 serializedSize(const QVector<QImage> &images)
+{
+    quint64 size = 0;
+#if FLUENT_COMMON_USE_KDE4
+    foreach (const QImage &image, images) {
+#else
+    for (const QImage &image : images) {
+#endif
+        size += align(sizeof(ImageHeader) + image.byteCount());
+    }
+    return size;
+}
+
+static void appendPadding(QByteArray &data)
+{
+    data.append(QByteArray(align(data.size()) - data.size(), '\0'));
+}
+
+ShadowDiskCache::ShadowDiskCache(const QString &fileName)
+    : m_fileName(fileName)
+{
+    map(m_fileName, m_mapping);
+}
+
+ShadowDiskCache::~ShadowDiskCache()
+{
+    unmap(m_mapping);
+}
+
+QString ShadowDiskCache::defaultFileName()
+{
+    // Relative paths in $XDG_CACHE_HOME are invalid according to the
+    // basedir spec and should be ignored.
+    QString cacheHome = QFile::decodeName(qgetenv("XDG_CACHE_HOME"));
+    if (cacheHome.isEmpty() || QDir::isRelativePath(cacheHome)) {
+        cacheHome = QDir::homePath() + QLatin1String("/.cache");
+    }
+
+    return cacheHome + QLatin1String("/fluent/shadows.cache");
+}
+
+QString ShadowDiskCache::fileName() const
+{
+    return m_fileName;
+}
+
+QByteArray ShadowDiskCache::hashKey(const QByteArray &key)
+{
+    QByteArray data = QByteArray::number(BoxShadowRenderer::version());
+    data.append(':');
+    data.append(key);
+    return QCryptographicHash::hash(data, QCryptographicHash::Md5);
+}
+
+QByteArray ShadowDiskCache::serialize(const QVector<QImage> &images)
+{
+    QByteArray data;
+#if FLUENT_COMMON_USE_KDE4
+    foreach (const QImage &image, images) {
+#else
+    for (const QImage &image : images) {
+#endif
+        ImageHeader header = {};
+        header.width = image.width();
+        header.height = image.height();
+        header.format = image.format();
+        header.bytesPerLine = image.bytesPerLine();
+#if FLUENT_COMMON_USE_KDE4
+        header.devicePixelRatio = 1.0;
+#else
+        header.devicePixelRatio = image.devicePixelRatio();
+#endif
+        data.append(reinterpret_cast<const char *>(&header), sizeof(header));
+        data.append(reinterpret_cast<const char *>(image.constBits()), image.byteCount());
+        appendPadding(data);
+    }
+    return data;
+}
+
+void ShadowDiskCache::map(const QString &fileName, Mapping &mapping)
+{
+    const int fd = ::open(QFile::encodeName(fileName).constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0
+        || info.st_size < qint64(sizeof(FileHeader))
+        || info.st_size > qint64(s_maxFileSize)) {
+        ::close(fd);
+        return;
+    }
+
+    const size_t size = info.st_size;
+    void *address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        return;
+    }
+
+    const uchar *data = static_cast<const uchar *>(address);
+
+    FileHeader header;
+    memcpy(&header, data, sizeof(header));
+
+    const quint64 indexEnd = sizeof(FileHeader) + quint64(header.entryCount) * sizeof(IndexEntry);
+    const bool headerValid = header.magic == s_magic
+        && header.formatVersion == s_formatVersion
+        && header.rendererVersion == quint32(BoxShadowRenderer::version())
+        && header.fileSize == size
+        && indexEnd <= size
+        && header.indexChecksum == checksum(data + sizeof(FileHeader), indexEnd - sizeof(FileHeader));
+
+    if (!headerValid) {
+        ::munmap(address, size);
+        return;
+    }
+
+    mapping.data = data;
+    mapping.size = size;
+
+    for (quint32 i = 0; i < header.entryCount; ++i) {
+        IndexEntry indexEntry;
+        memcpy(&indexEntry, data + sizeof(FileHeader) + i * sizeof(IndexEntry), sizeof(indexEntry));
+
+        if (indexEntry.offset < indexEnd
+            || indexEntry.offset % s_alignment != 0
+            || quint64(indexEntry.offset) + indexEntry.size > size) {
+            continue;
+        }
+
+        Entry entry = {};
+        entry.data = data + indexEntry.offset;
+        entry.size = indexEntry.size;
+        entry.checksum = indexEntry.checksum;
+        entry.imageCount = indexEntry.imageCount;
+
+        const QByteArray hash(indexEntry.hash, s_hashSize);
+        if (!mapping.entries.contains(hash)) {
+            mapping.entries.insert(hash, entry);
+            mapping.order.append(hash);
+        }
+    }
+}
+
+void ShadowDiskCache::unmap(Mapping &mapping)
+{
+    if (mapping.data) {
+        ::munmap(const_cast<uchar *>(mapping.data), mapping.size);
+    }
+
+    mapping = Mapping();
+}
+
+bool ShadowDiskCache::verify(Entry &entry)
+{
+    if (!entry.verified) {
+        entry.verified = true;
+        entry.corrupted = checksum(entry.data, entry.size) != entry.checksum;
+    }
+
+    return !entry.corrupted;
+}
+
+QVector<QImage> ShadowDiskCache::images(const Entry &entry)
+{
+    QVector<QImage> images;
+
+    quint32 offset = 0;
+    for (quint32 i = 0; i < entry.imageCount; ++i) {
+        if (offset + sizeof(ImageHeader) > entry.size) {
+            return {};
+        }
+
+        ImageHeader header;
+        memcpy(&header, entry.data + offset, sizeof(header));
+        offset += sizeof(ImageHeader);
+
+        const quint64 byteCount = quint64(header.bytesPerLine) * header.height;
+        if (header.format <= QImage::Format_Invalid
+            || header.format >= QImage::NImageFormats
+            || header.width == 0
+            || header.height == 0
+            || header.bytesPerLine % 4 != 0
+            || offset + byteCount > entry.size) {
+            return {};
+        }
+
+        const QImage mapped(entry.data + offset, header.width, header.height,
+            header.bytesPerLine, QImage::Format(header.format));
+        if (mapped.isNull() || mapped.bytesPerLine() != int(header.bytesPerLine)) {
+            return {};
+        }
+
+        // The mapping goes away when the file is written again.
+        QImage image = mapped.copy();
+#if !FLUENT_COMMON_USE_KDE4
+        image.setDevicePixelRatio(header.devicePixelRatio);
+#endif
+
+        images.append(image);
+        offset = align(offset + byteCount);
+    }
+
+    return images;
+}
+
+bool ShadowDiskCache::contains(const QByteArray &key) const
+{
+    const QByteArray hash = hashKey(key);
+
+    QMutexLocker locker(&m_mutex);
+    if (m_pending.contains(hash)) {
+        return true;
+    }
+
+    const QHash<QByteArray, Entry>::const_iterator it = m_mapping.entries.constFind(hash);
+    return it != m_mapping.entries.constEnd() && !it->corrupted;
+}
+
+QVector<QImage> ShadowDiskCache::find(const QByteArray &key)
+{
+    const QByteArray hash = hashKey(key);
+
+    QMutexLocker locker(&m_mutex);
+    const QHash<QByteArray, QVector<QImage> >::const_iterator pending = m_pending.constFind(hash);
+    if (pending != m_pending.constEnd()) {
+        return *pending;
+    }
+
+    QHash<QByteArray, Entry>::iterator it = m_mapping.entries.find(hash);
+    if (it == m_mapping.entries.end() || !verify(*it)) {
+        return {};
+    }
+
+    const QVector<QImage> result = images(*it);
+    if (result.isEmpty()) {
+        it->corrupted = true;
+    }
+
+    return result;
+}
+
+void ShadowDiskCache::insert(const QByteArray &key, const QVector<QImage> &images)
+{
+    const QByteArray hash = hashKey(key);
+
+    const quint64 size = serializedSize(images);
+    if (size > s_maxFileSize) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    removePending(hash);
+    m_pendingOrder.prepend(hash);
+    m_pending.insert(hash, images);
+    m_pendingSize += size;
+
+    // Images that would not fit in the file are never written, the oldest
+    // ones are dropped.
+    while (m_pendingSize > s_maxFileSize) {
+        removePending(m_pendingOrder.last());
+    }
+}
+
+void ShadowDiskCache::removePending(const QByteArray &hash)
+{
+    const QHash<QByteArray, QVector<QImage> >::iterator it = m_pending.find(hash);
+    if (it == m_pending.end()) {
+        return;
+    }
+
+    m_pendingSize -= serializedSize(*it);
+    m_pending.erase(it);
+    m_pendingOrder.removeOne(hash);
+}
+
+bool ShadowDiskCache::isDirty() const
+{
+    QMutexLocker locker(&m_mutex);
+    return !m_pendingOrder.isEmpty();
+}
+
+bool ShadowDiskCache::flush()
+{
+    QMutexLocker flushLocker(&m_flushMutex);
+
+    QList<QByteArray> hashes;
+    QHash<QByteArray, QVector<QImage> > pending;
+    {
+        QMutexLocker locker(&m_mutex);
+        hashes = m_pendingOrder;
+        pending = m_pending;
+    }
+
+    if (hashes.isEmpty()) {
+        return true;
+    }
+
+    // The file is written and mapped again outside of the lock, find()
+    // keeps using the pending images and the old mapping meanwhile.
+    const bool written = write(hashes, pending);
+
+    Mapping mapping;
+    if (written) {
+        map(m_fileName, mapping);
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+#if FLUENT_COMMON_USE_KDE4
+        foreach (const QByteArray &hash, hashes) {
+#else
+        for (const QByteArray &hash : qAsConst(hashes)) {
+#endif
+            removePending(hash);
+        }
+
+        if (written) {
+            qSwap(m_mapping, mapping);
+        }
+    }
+
+    // The images handed out are copies, nothing points into the old mapping.
+    unmap(mapping);
+    return written;
+}
+
+bool ShadowDiskCache::write(const QList<QByteArray> &hashes, const QHash<QByteArray, QVector<QImage> > &pending) const
+{
+    const QFileInfo info(m_fileName);
+    if (!QDir().mkpath(info.absolutePath())) {
+        return false;
+    }
+
+    // Writers of every process take turns, each one merges what the others
+    // wrote before it replaces the file.
+    const int lockFd = ::open(QFile::encodeName(m_fileName + QLatin1String(".lock")).constData(),
+        O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (lockFd < 0) {
+        return false;
+    }
+
+    while (::flock(lockFd, LOCK_EX) != 0) {
+        if (errno != EINTR) {
+            ::close(lockFd);
+            return false;
+        }
+    }
+
+    Mapping current;
+    map(m_fileName, current);
+
+    // The new entries go first, newest first, followed by the valid entries
+    // of the current file, as long as they fit.
+    struct Chunk {
+        QByteArray hash;
+        const uchar *data;
+        quint32 size;
+        quint32 imageCount;
+    };
+
+    QList<QByteArray> serialized;
+    QList<Chunk> chunks;
+    quint32 dataSize = 0;
+
+    auto append = [&chunks, &dataSize](const QByteArray &hash, const uchar *data, quint32 size, quint32 imageCount) {
+        const quint32 indexSize = (chunks.size() + 1) * sizeof(IndexEntry);
+        if (align(sizeof(FileHeader) + indexSize) + dataSize + align(size) > s_maxFileSize) {
+            return;
+        }
+
+        const Chunk chunk = { hash, data, size, imageCount };
+        chunks.append(chunk);
+        dataSize += align(size);
+    };
+
+#if FLUENT_COMMON_USE_KDE4
+    foreach (const QByteArray &hash, hashes) {
+#else
+    for (const QByteArray &hash : hashes) {
+#endif
+        const QVector<QImage> entryImages = pending.value(hash);
+        serialized.append(serialize(entryImages));
+        append(hash, reinterpret_cast<const uchar *>(serialized.last().constData()),
+            serialized.last().size(), entryImages.size());
+    }
+
+#if FLUENT_COMMON_USE_KDE4
+    foreach (const QByteArray &hash, current.order) {
+#else
+    for (const QByteArray &hash : qAsConst(current.order)) {
+#endif
+        Entry &entry = current.entries[hash];
+        if (!pending.contains(hash) && verify(entry)) {
+            append(hash, entry.data, entry.size, entry.imageCount);
+        }
+    }
+
+    bool written = false;
+    if (!chunks.isEmpty()) {
+        const quint32 dataOffset = align(sizeof(FileHeader) + chunks.size() * sizeof(IndexEntry));
+
+        QByteArray index;
+        QByteArray data;
+#if FLUENT_COMMON_USE_KDE4
+        foreach (const Chunk &chunk, chunks) {
+#else
+        for (const Chunk &chunk : qAsConst(chunks)) {
+#endif
+            IndexEntry indexEntry = {};
+            memcpy(indexEntry.hash, chunk.hash.constData(), s_hashSize);
+            indexEntry.offset = dataOffset + data.size();
+            indexEntry.size = chunk.size;
+            indexEntry.checksum = checksum(chunk.data, chunk.size);
+            indexEntry.imageCount = chunk.imageCount;
+            index.append(reinterpret_cast<const char *>(&indexEntry), sizeof(indexEntry));
+
+            data.append(reinterpret_cast<const char *>(chunk.data), chunk.size);
+            appendPadding(data);
+        }
+
+        FileHeader header = {};
+        header.magic = s_magic;
+        header.formatVersion = s_formatVersion;
+        header.rendererVersion = BoxShadowRenderer::version();
+        header.fileSize = dataOffset + data.size();
+        header.entryCount = chunks.size();
+        header.indexChecksum = checksum(reinterpret_cast<const uchar *>(index.constData()), index.size());
+
+        QByteArray contents;
+        contents.reserve(header.fileSize);
+        contents.append(reinterpret_cast<const char *>(&header), sizeof(header));
+        contents.append(index);
+        contents.append(QByteArray(dataOffset - contents.size(), '\0'));
+        contents.append(data);
+
+        // Write a temporary file next to the cache file and rename it over
+        // the cache file, so readers either see the old or the new file.
+        const QString temporaryFileName = QString::fromLatin1("%1.%2.tmp").arg(m_fileName).arg(::getpid());
+        QFile temporaryFile(temporaryFileName);
+        if (temporaryFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            written = temporaryFile.write(contents) == contents.size()
+                && temporaryFile.flush()
+                && ::fsync(temporaryFile.handle()) == 0;
+            temporaryFile.close();
+
+            written = written && ::rename(QFile::encodeName(temporaryFileName).constData(),
+                                          QFile::encodeName(m_fileName).constData()) == 0;
+        }
+
+        if (!written) {
+            QFile::remove(temporaryFileName);
+        }
+    }
+
+    unmap(current);
+
+    // Closing the file releases the lock.
+    ::close(lockFd);
+    return written;
+}
+
+} // namespace Fluent
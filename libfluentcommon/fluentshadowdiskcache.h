@@ -0,0 +1,162 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#pragma once
+
+// own
+#include "fluentcommon_export.h"
+
+// Qt
+#include <QByteArray>
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+namespace Fluent
+{
+
+/**
+ * Shadow textures stored in a file, so they survive the process.
+ *
+ * The file is mapped read-only, the images found in it are copied out of
+ * the mapping: a shadow found in the file costs a copy but no blur, and the
+ * mapping can be dropped as soon as the file is replaced.
+ *
+ * Inserted images stay in memory until flush() writes them, at most as many
+ * as fit in the file, the oldest ones are dropped first. flush() takes
+ * an advisory lock on the file, merges the inserted images with the entries
+ * of the file as it is at that time, whichever process wrote them, and
+ * atomically replaces the file with a temporary one. It blocks on disk I/O,
+ * call it from a background thread.
+ *
+ * Every entry carries a checksum that is verified the first time the entry
+ * is used, a corrupted entry is ignored and dropped the next time the file
+ * is written.
+ *
+ * All the methods are thread-safe.
+ **/
+class FLUENTCOMMON_EXPORT ShadowDiskCache
+{
+public:
+    /**
+     * Open the cache file, if it exists and is valid.
+     * @param fileName The path of the cache file.
+     **/
+    explicit ShadowDiskCache(const QString &fileName);
+
+    ~ShadowDiskCache();
+
+    /**
+     * The path of the cache file, in $XDG_CACHE_HOME.
+     **/
+    static QString defaultFileName();
+
+    /**
+     * The path of the cache file.
+     **/
+    QString fileName() const;
+
+    /**
+     * Whether images are stored for a key.
+     *
+     * The entry is not verified, find() can still fail for it.
+     * @param key The key, as returned by BoxShadowRenderer::cacheKey().
+     **/
+    bool contains(const QByteArray &key) const;
+
+    /**
+     * Look up the images stored for a key.
+     * @param key The key, as returned by BoxShadowRenderer::cacheKey().
+     * @returns The images, or an empty list if the key is not stored or the entry is corrupted.
+     **/
+    QVector<QImage> find(const QByteArray &key);
+
+    /**
+     * Store images for a key, in memory until the next flush().
+     * @param key The key, as returned by BoxShadowRenderer::cacheKey().
+     * @param images The images.
+     **/
+    void insert(const QByteArray &key, const QVector<QImage> &images);
+
+    /**
+     * Whether images have been inserted since the last flush().
+     **/
+    bool isDirty() const;
+
+    /**
+     * Write the images inserted since the last flush() to the file.
+     *
+     * The images are written at most once: they are not kept for another
+     * try if the file cannot be written.
+     * @returns Whether the file has been written, true if there was nothing to write.
+     **/
+    bool flush();
+
+private:
+    Q_DISABLE_COPY(ShadowDiskCache)
+
+    struct Entry {
+        const uchar *data;
+        quint32 size;
+        quint32 checksum;
+        quint32 imageCount;
+        bool verified;
+        bool corrupted;
+    };
+
+    // A mapped cache file, and its entries keyed by the hash of their key.
+    struct Mapping {
+        const uchar *data = nullptr;
+        size_t size = 0;
+        QHash<QByteArray, Entry> entries;
+        QList<QByteArray> order;
+    };
+
+    static QByteArray hashKey(const QByteArray &key);
+    static QByteArray serialize(const QVector<QImage> &images);
+
+    static void map(const QString &fileName, Mapping &mapping);
+    static void unmap(Mapping &mapping);
+    static bool verify(Entry &entry);
+    static QVector<QImage> images(const Entry &entry);
+
+    bool write(const QList<QByteArray> &hashes, const QHash<QByteArray, QVector<QImage> > &pending) const;
+
+    // Drop pending images, m_mutex must be held.
+    void removePending(const QByteArray &hash);
+
+    QString m_fileName;
+
+    mutable QMutex m_mutex;
+
+    // Held during flush(), which does its I/O outside of m_mutex.
+    QMutex m_flushMutex;
+
+    Mapping m_mapping;
+
+    // Images inserted since the last flush, keyed by the hash of their key,
+    // and the order they were inserted in, newest first.
+    QHash<QByteArray, QVector<QImage> > m_pending;
+    QList<QByteArray> m_pendingOrder;
+
+    // The serialized size of the pending images.
+    quint64 m_pendingSize = 0;
+};
+
+} // namespace Fluent
@@ -0,0 +1,147 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#pragma once
+
+// Qt
+#include <QPoint>
+#include <QtGlobal>
+
+namespace Fluent
+{
+
+/**
+ * One layer of a shadow.
+ **/
+struct ShadowParams
+{
+    ShadowParams() = default;
+
+    ShadowParams(const QPoint &offset, int radius, qreal opacity)
+        : offset(offset)
+        , radius(radius)
+        , opacity(opacity)
+    {}
+
+    QPoint offset;
+    int radius = 0;
+    qreal opacity = 0;
+};
+
+/**
+ * A shadow made of two layers, moved by a common offset.
+ **/
+struct CompositeShadowParams
+{
+    CompositeShadowParams() = default;
+
+    CompositeShadowParams(
+            const QPoint &offset,
+            const ShadowParams &shadow1,
+            const ShadowParams &shadow2)
+        : offset(offset)
+        , shadow1(shadow1)
+        , shadow2(shadow2)
+    {}
+
+    bool isNone() const
+    {
+        return qMax(shadow1.radius, shadow2.radius) == 0;
+    }
+
+    QPoint offset;
+    ShadowParams shadow1;
+    ShadowParams shadow2;
+};
+
+/**
+ * The shadow sizes, in the order of the ShadowSize choices of the
+ * decoration and style settings.
+ **/
+enum ShadowSize {
+    ShadowNone,
+    ShadowSmall,
+    ShadowMedium,
+    ShadowLarge,
+    ShadowVeryLarge,
+    ShadowSizeCount
+};
+
+/**
+ * The shadows of the window decoration, indexed by ShadowSize.
+ **/
+static const CompositeShadowParams s_decorationShadowParams[ShadowSizeCount] = {
+    // None
+    CompositeShadowParams(),
+    // Small
+    CompositeShadowParams(
+        QPoint(0, 4),
+        ShadowParams(QPoint(0, 0), 16, 1),
+        ShadowParams(QPoint(0, -2), 8, 0.4)),
+    // Medium
+    CompositeShadowParams(
+        QPoint(0, 8),
+        ShadowParams(QPoint(0, 0), 32, 0.9),
+        ShadowParams(QPoint(0, -4), 16, 0.3)),
+    // Large
+    CompositeShadowParams(
+        QPoint(0, 12),
+        ShadowParams(QPoint(0, 0), 48, 0.8),
+        ShadowParams(QPoint(0, -6), 24, 0.2)),
+    // Very large
+    CompositeShadowParams(
+        QPoint(0, 16),
+        ShadowParams(QPoint(0, 0), 64, 0.7),
+        ShadowParams(QPoint(0, -8), 32, 0.1)),
+};
+
+/**
+ * The shadows of the menus and tooltips of the widget style, indexed by ShadowSize.
+ **/
+static const CompositeShadowParams s_styleShadowParams[ShadowSizeCount] = {
+    // None
+    CompositeShadowParams(),
+    // Small
+    CompositeShadowParams(
+        QPoint(0, 3),
+        ShadowParams(QPoint(0, 0), 12, 0.26),
+        ShadowParams(QPoint(0, -2), 6, 0.16)),
+    // Medium
+    CompositeShadowParams(
+        QPoint(0, 4),
+        ShadowParams(QPoint(0, 0), 16, 0.24),
+        ShadowParams(QPoint(0, -2), 8, 0.14)),
+    // Large
+    CompositeShadowParams(
+        QPoint(0, 5),
+        ShadowParams(QPoint(0, 0), 20, 0.22),
+        ShadowParams(QPoint(0, -3), 10, 0.12)),
+    // Very Large
+    CompositeShadowParams(
+        QPoint(0, 6),
+        ShadowParams(QPoint(0, 0), 24, 0.2),
+        ShadowParams(QPoint(0, -3), 12, 0.1))
+};
+
+/**
+ * The shadow of a size from one of the tables above, Large for unknown sizes.
+ **/
+inline CompositeShadowParams lookupShadowParams(const CompositeShadowParams *params, int size)
+{
+    return size >= ShadowNone && size < ShadowSizeCount ? params[size] : params[ShadowLarge];
+}
+
+} // namespace Fluent